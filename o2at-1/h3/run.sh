@@ -1,3 +1,3 @@
-export OPTIONS="-b --configuration json://config.json"
+export OPTIONS="-b --configuration json://config.json ${AOD_MEMORY_RATE_LIMIT:+--aod-memory-rate-limit ${AOD_MEMORY_RATE_LIMIT}} ${SHM_SEGMENT_SIZE:+--shm-segment-size ${SHM_SEGMENT_SIZE}}"
 
 o2-analysistutorial-h3-5-v0mcexample ${OPTIONS} | o2-analysis-timestamp ${OPTIONS} | o2-analysis-track-propagation ${OPTIONS} | o2-analysis-event-selection ${OPTIONS} | o2-analysis-lf-lambdakzerobuilder ${OPTIONS} | o2-analysis-pid-tpc ${OPTIONS} | o2-analysis-multiplicity-table ${OPTIONS}
@@ -0,0 +1,67 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright
+// holders. All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+///
+/// \file DerivedTableEncoding.h
+/// \brief Lossy 16-bit encodings of the float columns of the derived table MyTable,
+///        shared by the steps that produce it (2, 3) and read it (3, 4)
+/// \author
+/// \since
+
+#ifndef O2AT_H4_DERIVEDTABLEENCODING_H_
+#define O2AT_H4_DERIVEDTABLEENCODING_H_
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace o2::aod::mytable
+{
+/// Lossy encoding of a float in [min, max] as an unsigned integer on a linear or logarithmic grid
+/// Codes 0 and codeMax are the limits of the range. Values outside the range are saturated:
+/// they are stored as the nearest limit and their actual value is lost. NaN is stored as the lower limit.
+/// The ranges must therefore contain all values the analysis of the derived table distinguishes.
+template <typename TStored, bool isLog = false>
+struct Encoding {
+  static constexpr TStored codeMax = std::numeric_limits<TStored>::max(); // code of the upper limit
+  float min;
+  float max;
+  float origin; // lower limit on the grid
+  float step;   // grid distance between consecutive codes
+
+  // the origin and the step are computed once here, not for every encoded or decoded value
+  Encoding(float minValue, float maxValue) : min(minValue), max(maxValue), origin(toGrid(minValue)), step((toGrid(maxValue) - origin) / codeMax) {}
+
+  static float toGrid(float value) { return isLog ? std::log(value) : value; }
+  static float fromGrid(float value) { return isLog ? std::exp(value) : value; }
+
+  TStored encode(float value) const
+  {
+    if (!(value > min)) {
+      return 0;
+    }
+    if (value >= max) {
+      return codeMax;
+    }
+    return static_cast<TStored>(std::lround((toGrid(value) - origin) / step));
+  }
+
+  float decode(TStored code) const { return fromGrid(origin + code * step); }
+};
+
+// The ranges are wider than those of the histograms of the reading steps, so that a saturated value
+// stays in the same histogram bin (the first bin, the underflow or the overflow) as the original value.
+// The encodings are not constexpr, because std::log is not.
+inline const Encoding<uint16_t> encodingInvMass{1.5f, 2.3f};        // steps of 12 keV/c^2
+inline const Encoding<uint16_t, true> encodingPt{0.1f, 100.f};      // relative steps of 1.1e-4
+inline const Encoding<uint16_t> encodingCosinePointing{-1.f, 1.f}; // steps of 3.1e-5
+} // namespace o2::aod::mytable
+
+#endif // O2AT_H4_DERIVEDTABLEENCODING_H_
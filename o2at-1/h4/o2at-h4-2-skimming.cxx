@@ -22,6 +22,8 @@
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/DataModel/CandidateSelectionTables.h"
 
+#include "DerivedTableEncoding.h"
+
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::framework::expressions;
@@ -31,23 +33,40 @@ using namespace o2::framework::expressions;
 // this can be done in a separated header file, but for semplicity we do it in
 // the same file here
 
+// the floats are stored as 16-bit integers with the encodings of DerivedTableEncoding.h,
+// which makes the derived table much smaller; values outside the ranges of the encodings
+// are saturated and only the resolution of the grid is kept (see step 1 for the plain
+// float columns); the values are decoded by dynamic columns with the original names,
+// so the reading code does not change
 namespace o2::aod
 {
 namespace mytable
 {
-DECLARE_SOA_COLUMN(InvMassD0, invMassD0, float);           //!
-DECLARE_SOA_COLUMN(InvMassD0bar, invMassD0bar, float);     //!
-DECLARE_SOA_COLUMN(Pt, pt, float);                         //!
-DECLARE_SOA_COLUMN(CosinePointing, cosinePointing, float); //!
-DECLARE_SOA_INDEX_COLUMN(Collision, collision);            //!
+DECLARE_SOA_COLUMN(InvMassD0Code, invMassD0Code, uint16_t);           //!
+DECLARE_SOA_COLUMN(InvMassD0barCode, invMassD0barCode, uint16_t);     //!
+DECLARE_SOA_COLUMN(PtCode, ptCode, uint16_t);                         //!
+DECLARE_SOA_COLUMN(CosinePointingCode, cosinePointingCode, uint16_t); //!
+DECLARE_SOA_INDEX_COLUMN(Collision, collision);                       //!
+DECLARE_SOA_DYNAMIC_COLUMN(InvMassD0, invMassD0,                      //!
+                           [](uint16_t code) -> float { return encodingInvMass.decode(code); });
+DECLARE_SOA_DYNAMIC_COLUMN(InvMassD0bar, invMassD0bar, //!
+                           [](uint16_t code) -> float { return encodingInvMass.decode(code); });
+DECLARE_SOA_DYNAMIC_COLUMN(Pt, pt, //!
+                           [](uint16_t code) -> float { return encodingPt.decode(code); });
+DECLARE_SOA_DYNAMIC_COLUMN(CosinePointing, cosinePointing, //!
+                           [](uint16_t code) -> float { return encodingCosinePointing.decode(code); });
 } // namespace mytable
 
 DECLARE_SOA_TABLE(MyTable, "AOD", "MYTABLE", //!
-                  mytable::InvMassD0,
-                  mytable::InvMassD0bar,
-                  mytable::Pt,
-                  mytable::CosinePointing,
-                  mytable::CollisionId)
+                  mytable::InvMassD0Code,
+                  mytable::InvMassD0barCode,
+                  mytable::PtCode,
+                  mytable::CosinePointingCode,
+                  mytable::CollisionId,
+                  mytable::InvMassD0<mytable::InvMassD0Code>,
+                  mytable::InvMassD0bar<mytable::InvMassD0barCode>,
+                  mytable::Pt<mytable::PtCode>,
+                  mytable::CosinePointing<mytable::CosinePointingCode>)
 
 } // namespace o2::aod
 
@@ -81,7 +100,11 @@ struct ProduceDerivedTable { //<- workflow that loops over HF 2-prong
       // we retrieve also the event index from one of the daughters
       auto dauTrack = cand.prong0_as<aod::Tracks>(); // positive daughter
 
-      tableWithDzeroCandidates(invMassD0, invMassD0bar, cand.pt(), cand.cpa(), dauTrack.collisionId());
+      tableWithDzeroCandidates(aod::mytable::encodingInvMass.encode(invMassD0),
+                               aod::mytable::encodingInvMass.encode(invMassD0bar),
+                               aod::mytable::encodingPt.encode(cand.pt()),
+                               aod::mytable::encodingCosinePointing.encode(cand.cpa()),
+                               dauTrack.collisionId());
     }
   }
 };
@@ -22,6 +22,8 @@
 #include "PWGHF/DataModel/CandidateReconstructionTables.h"
 #include "PWGHF/DataModel/CandidateSelectionTables.h"
 
+#include "DerivedTableEncoding.h"
+
 using namespace o2;
 using namespace o2::framework;
 using namespace o2::framework::expressions;
@@ -31,23 +33,40 @@ using namespace o2::framework::expressions;
 // this can be done in a separated header file, but for semplicity we do it in
 // the same file here
 
+// the floats are stored as 16-bit integers with the encodings of DerivedTableEncoding.h,
+// which makes the derived table much smaller; values outside the ranges of the encodings
+// are saturated and only the resolution of the grid is kept (see step 1 for the plain
+// float columns); the values are decoded by dynamic columns with the original names,
+// so the reading code does not change
 namespace o2::aod
 {
 namespace mytable
 {
-DECLARE_SOA_COLUMN(InvMassD0, invMassD0, float);           //!
-DECLARE_SOA_COLUMN(InvMassD0bar, invMassD0bar, float);     //!
-DECLARE_SOA_COLUMN(Pt, pt, float);                         //!
-DECLARE_SOA_COLUMN(CosinePointing, cosinePointing, float); //!
-DECLARE_SOA_INDEX_COLUMN(Collision, collision);            //!
+DECLARE_SOA_COLUMN(InvMassD0Code, invMassD0Code, uint16_t);           //!
+DECLARE_SOA_COLUMN(InvMassD0barCode, invMassD0barCode, uint16_t);     //!
+DECLARE_SOA_COLUMN(PtCode, ptCode, uint16_t);                         //!
+DECLARE_SOA_COLUMN(CosinePointingCode, cosinePointingCode, uint16_t); //!
+DECLARE_SOA_INDEX_COLUMN(Collision, collision);                       //!
+DECLARE_SOA_DYNAMIC_COLUMN(InvMassD0, invMassD0,                      //!
+                           [](uint16_t code) -> float { return encodingInvMass.decode(code); });
+DECLARE_SOA_DYNAMIC_COLUMN(InvMassD0bar, invMassD0bar, //!
+                           [](uint16_t code) -> float { return encodingInvMass.decode(code); });
+DECLARE_SOA_DYNAMIC_COLUMN(Pt, pt, //!
+                           [](uint16_t code) -> float { return encodingPt.decode(code); });
+DECLARE_SOA_DYNAMIC_COLUMN(CosinePointing, cosinePointing, //!
+                           [](uint16_t code) -> float { return encodingCosinePointing.decode(code); });
 } // namespace mytable
 
 DECLARE_SOA_TABLE(MyTable, "AOD", "MYTABLE", //!
-                  mytable::InvMassD0,
-                  mytable::InvMassD0bar,
-                  mytable::Pt,
-                  mytable::CosinePointing,
-                  mytable::CollisionId)
+                  mytable::InvMassD0Code,
+                  mytable::InvMassD0barCode,
+                  mytable::PtCode,
+                  mytable::CosinePointingCode,
+                  mytable::CollisionId,
+                  mytable::InvMassD0<mytable::InvMassD0Code>,
+                  mytable::InvMassD0bar<mytable::InvMassD0barCode>,
+                  mytable::Pt<mytable::PtCode>,
+                  mytable::CosinePointing<mytable::CosinePointingCode>)
 
 } // namespace o2::aod
 
@@ -81,7 +100,11 @@ struct ProduceDerivedTable { //<- workflow that loops over HF 2-prong
       // we retrieve also the event index from one of the daughters
       auto dauTrack = cand.prong0_as<aod::Tracks>(); // positive daughter
 
-      tableWithDzeroCandidates(invMassD0, invMassD0bar, cand.pt(), cand.cpa(), dauTrack.collisionId());
+      tableWithDzeroCandidates(aod::mytable::encodingInvMass.encode(invMassD0),
+                               aod::mytable::encodingInvMass.encode(invMassD0bar),
+                               aod::mytable::encodingPt.encode(cand.pt()),
+                               aod::mytable::encodingCosinePointing.encode(cand.cpa()),
+                               dauTrack.collisionId());
     }
   }
 };
@@ -95,7 +118,15 @@ struct ReadDerivedTable { //<- workflow that reads derived table and fill
                               {"hPt", ";#it{p}_{T} (GeV/#it{c});counts", {HistType::kTH1F, {{50, 0., 50.}}}},
                               {"hCosp", ";cos(#vartheta_{P}) ;counts", {HistType::kTH1F, {{100, 0.8, 1.}}}}}};
 
-  void process(aod::MyTable const& cand2Prongs)
+  Configurable<float> ptMin{"ptMin", 0., "min. pT of the candidates (GeV/c)"};
+
+  // the cut is applied on the stored pT code (pT = min * exp(code * step) on the logarithmic grid)
+  // instead of on the decoded pT; the threshold is only computed for ptMin above the lower limit of
+  // the grid, so that the code 0 of the saturated candidates passes only for ptMin at or below that limit
+  Filter filterPt = aod::mytable::ptCode >= ifnode(ptMin > aod::mytable::encodingPt.min,
+                                                   nlog(ptMin / aod::mytable::encodingPt.min) / aod::mytable::encodingPt.step, 0.f);
+
+  void process(soa::Filtered<aod::MyTable> const& cand2Prongs)
   {
 
     // loop over 2-prong candidates
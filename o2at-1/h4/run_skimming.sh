@@ -2,13 +2,93 @@
 #For the simple reading, it should suffice to do:
 #o2-analysistutorial-h4-4-skimming --aod-file AO2D.root
 #...with the resulting file!
-export OPTIONS="-b --configuration json://dpl-config-skimming.json --resources-monitoring 2 --aod-memory-rate-limit 1000000000 --shm-segment-size 7500000000"
+#
+#Incremental mode: INPUT_LIST=list.txt bash run_skimming.sh
+#Skims every input AO2D listed in list.txt (one path per line) into its own directory
+#in SKIM_DIR (default: skims) and records it in the tab-separated manifest SKIM_DIR/manifest.txt
+#(input identity, configuration hash, output directory relative to SKIM_DIR). The configuration hash covers the contents
+#of dpl-config-skimming.json and OutputDirector.json. On rerun, the inputs already skimmed with the
+#same configuration are skipped, so only the new files are processed.
+#The outputs of the current configuration are listed in SKIM_DIR/AO2D_list.txt, to be read with
+#o2-analysistutorial-h4-4-skimming --aod-file @skims/AO2D_list.txt
+#
+#On machines with little memory, lower the shared-memory segment together with the AOD reading rate limit
+#(the segment must hold the data in flight), e.g.
+#SHM_SEGMENT_SIZE=2000000000 AOD_MEMORY_RATE_LIMIT=500000000 bash run_skimming.sh
+#
+#The derived tables are written with the default ROOT compression. Small skims that are read
+#many times can be written uncompressed with AOD_WRITER_COMPRESSION=0, so that reading them needs
+#no decompression (ROOT compression setting: algorithm * 100 + level, e.g. 505 for ZSTD level 5).
+#
+#The configuration files are taken from the current directory.
+CONFIG_FILE="dpl-config-skimming.json"
+WRITER_FILE="OutputDirector.json"
+for FILE in "${CONFIG_FILE}" "${WRITER_FILE}"; do
+  if [ ! -f "${FILE}" ]; then
+    echo "Error: ${FILE} not found in $(pwd)"
+    exit 1
+  fi
+done
+export OPTIONS="-b --configuration json://${CONFIG_FILE} --resources-monitoring 2 --aod-memory-rate-limit ${AOD_MEMORY_RATE_LIMIT:-1000000000} --shm-segment-size ${SHM_SEGMENT_SIZE:-7500000000}"
 echo "options: ${OPTIONS}"
-o2-analysis-timestamp ${OPTIONS} | \
-o2-analysis-event-selection ${OPTIONS} | \
-o2-analysis-multiplicity-table ${OPTIONS} | \
-o2-analysis-track-propagation ${OPTIONS} | \
-o2-analysis-trackselection ${OPTIONS} | \
-o2-analysis-hf-track-index-skim-creator ${OPTIONS} | \
-o2-analysis-hf-candidate-creator-2prong ${OPTIONS} | \
-o2-analysistutorial-h4-3-skimming ${OPTIONS} --aod-writer-json OutputDirector.json --fairmq-ipc-prefix .
+WRITER_OPTIONS="--aod-writer-json ${WRITER_FILE} ${AOD_WRITER_COMPRESSION:+--aod-writer-compression ${AOD_WRITER_COMPRESSION}}"
+
+# runs the skimming chain, extra options (e.g. the input file) are passed to all devices
+run_chain() {
+  o2-analysis-timestamp ${OPTIONS} "$@" | \
+  o2-analysis-event-selection ${OPTIONS} "$@" | \
+  o2-analysis-multiplicity-table ${OPTIONS} "$@" | \
+  o2-analysis-track-propagation ${OPTIONS} "$@" | \
+  o2-analysis-trackselection ${OPTIONS} "$@" | \
+  o2-analysis-hf-track-index-skim-creator ${OPTIONS} "$@" | \
+  o2-analysis-hf-candidate-creator-2prong ${OPTIONS} "$@" | \
+  o2-analysistutorial-h4-3-skimming ${OPTIONS} "$@" ${WRITER_OPTIONS} --fairmq-ipc-prefix .
+}
+
+if [ -z "${INPUT_LIST}" ]; then
+  run_chain
+  exit $?
+fi
+
+SKIM_DIR="$(realpath -m "${SKIM_DIR:-skims}")"
+MANIFEST="${SKIM_DIR}/manifest.txt"
+mkdir -p "${SKIM_DIR}"
+touch "${MANIFEST}"
+
+# the configuration hash covers only the contents of the configuration files, which define the skims
+# (not their location, the resource limits or the writer compression)
+CONFIG_HASH=$(cat "${CONFIG_FILE}" "${WRITER_FILE}" | sha256sum | cut -c 1-16)
+echo "configuration hash: ${CONFIG_HASH}"
+
+while IFS= read -r FILE_IN; do
+  [ -z "${FILE_IN}" ] && continue
+  # identity of the input: path, size and modification time (only the path for remote files)
+  if [ -f "${FILE_IN}" ]; then
+    ID="$(realpath "${FILE_IN}"):$(stat -c '%s:%Y' "${FILE_IN}")"
+  else
+    ID="${FILE_IN}"
+  fi
+  if ID="${ID}" awk -F '\t' -v hash="${CONFIG_HASH}" '$1 == ENVIRON["ID"] && $2 == hash { found = 1 } END { exit !found }' "${MANIFEST}"; then
+    echo "skipping ${FILE_IN} (already skimmed)"
+    continue
+  fi
+  NAME_OUT="$(echo "${ID} ${CONFIG_HASH}" | sha256sum | cut -c 1-16)"
+  DIR_OUT="${SKIM_DIR}/${NAME_OUT}"
+  echo "skimming ${FILE_IN} into ${DIR_OUT}"
+  rm -rf "${DIR_OUT}" && mkdir -p "${DIR_OUT}"
+  # the chain runs in the output directory, with a copy of the configuration it was made with
+  cp "${CONFIG_FILE}" "${WRITER_FILE}" "${DIR_OUT}/"
+  # resolve relative input paths before changing to the output directory
+  [ -f "${FILE_IN}" ] && FILE_IN="$(realpath "${FILE_IN}")"
+  if (cd "${DIR_OUT}" && run_chain --aod-file "${FILE_IN}" < /dev/null > log_skimming.txt 2>&1); then
+    printf '%s\t%s\t%s\n' "${ID}" "${CONFIG_HASH}" "${NAME_OUT}" >> "${MANIFEST}"
+  else
+    echo "Error: skimming of ${FILE_IN} failed, check ${DIR_OUT}/log_skimming.txt"
+  fi
+done < "${INPUT_LIST}"
+
+# list of the derived files of the current configuration
+awk -F '\t' -v hash="${CONFIG_HASH}" '$2 == hash { print $3 }' "${MANIFEST}" | while IFS= read -r NAME_OUT; do
+  find "${SKIM_DIR}/${NAME_OUT}" -maxdepth 1 -name "AO2D*.root"
+done > "${SKIM_DIR}/AO2D_list.txt"
+echo "derived files: $(wc -l < "${SKIM_DIR}/AO2D_list.txt"), listed in ${SKIM_DIR}/AO2D_list.txt"
@@ -0,0 +1,144 @@
+#!/bin/bash
+
+# Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+# See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+# All rights not expressly granted are reserved.
+#
+# This software is distributed under the terms of the GNU General Public
+# License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+#
+# In applying this license CERN does not waive the privileges and immunities
+# granted to it by virtue of its status as an Intergovernmental Organization
+# or submit itself to any jurisdiction.
+
+# @brief Bash script to benchmark the optimised D0 mini task (taskMini_opt.cxx) on synthetic input
+#
+# Generates a synthetic AO2D file (unless it exists), runs the optimised mini task on it and reports
+# the throughput of the track selection, the skim creator and the candidate creator per CPU second of the device,
+# and the CPU time and the peak resident memory of each device, from the DPL resource monitoring.
+# The vertex fits are counted with the fitter QA of both fitting devices (fillFitterQa).
+# The configuration dpl-config_benchmark.json is specific to taskMini_opt.cxx.
+# The synthetic file contains the PID and DCA tables, so no helper tasks and no CCDB access are needed.
+#
+# The chain can be run in several modes, which differ in what the devices exchange (space-separated list in BENCHMARK_MODES):
+# refit  - the skim creator passes the track index rows and the candidate creator refits the vertices (default)
+# stored - the skim creator also passes its vertex fit results and the candidate creator does not refit
+#
+# Usage: [BENCHMARK_MODES="refit stored"] benchmark_mini.sh [number of dataframes] [collisions per dataframe] [tracks per collision]
+
+# benchmark modes
+MODES=${BENCHMARK_MODES:-refit}
+
+# directory of this script
+DIR_THIS="$(dirname "$(realpath "$0")")"
+
+# synthetic input
+N_DF=${1:-10}
+N_COLLISIONS=${2:-100}
+N_TRACKS=${3:-50}
+FILE_AOD="AO2D_synthetic.root"
+
+# base O2 configuration file (in the same directory), adapted to each mode
+JSON="$DIR_THIS/dpl-config_benchmark.json"
+
+# command line options of O2 workflows
+OPTIONS="-b --aod-memory-rate-limit 2000000000 --shm-segment-size 16000000000 --min-failure-level error --resources-monitoring 1"
+
+# executable of the optimised mini task, which is not part of O2Physics
+WORKFLOW="o2-analysistutorial-hf-task-mini-opt"
+if ! command -v "$WORKFLOW" > /dev/null; then
+  echo "Error: $WORKFLOW not found. Build it as described in $DIR_THIS/README.md."
+  exit 1
+fi
+
+# generate the synthetic input
+if [ ! -f "$FILE_AOD" ]; then
+  echo "Generating $FILE_AOD with $N_DF dataframes, $N_COLLISIONS collisions per dataframe, $N_TRACKS tracks per collision"
+  root -b -q -l "$DIR_THIS/makeSyntheticAO2D.C+(\"$FILE_AOD\", $N_DF, $N_COLLISIONS, $N_TRACKS)" || exit 1
+fi
+
+# Runs the mini task workflow in one mode and reports its throughput and memory
+run_mode() {
+  local mode="$1"
+  local logfile="log_benchmark_${mode}.txt"
+  local json="dpl-config_benchmark_${mode}.json"
+
+  # configuration of the mode
+  python3 - "$JSON" "$json" "$mode" << 'END' || return 1
+import json
+import sys
+
+path_in, path_out, mode = sys.argv[1:4]
+with open(path_in) as file:
+    config = json.load(file)
+stored = {"refit": "false", "stored": "true"}.get(mode)
+if stored is None:
+    sys.exit(f"Unknown mode {mode}")
+config["hf-track-index-skim-creator"]["fillFitResults"] = stored
+config["hf-candidate-creator2-prong"]["processRefit"] = "false" if stored == "true" else "true"
+config["hf-candidate-creator2-prong"]["processFitResults"] = stored
+with open(path_out, "w") as file:
+    json.dump(config, file, indent=4)
+    file.write("\n")
+END
+
+  # execute the mini task workflow
+  echo "Mode: $mode"
+  # shellcheck disable=SC2086 # Ignore unquoted options.
+  "$WORKFLOW" $OPTIONS --configuration "json://$PWD/$json" > "$logfile" 2>&1
+  local rc=$?
+  if [ $rc -ne 0 ]; then
+    echo "Error: Exit code $rc"
+    echo "Check the log file $logfile"
+    return $rc
+  fi
+  mv AnalysisResults.root "AnalysisResults_${mode}.root"
+  mv performanceMetrics.json "performanceMetrics_${mode}.json"
+
+  # report CPU time and peak resident memory per device from the DPL resource monitoring
+  python3 - "performanceMetrics_${mode}.json" "cpuTimes_${mode}.txt" << 'END' || return 1
+import json
+import sys
+
+path_metrics, path_times = sys.argv[1:3]
+with open(path_metrics) as file:
+    metrics = json.load(file)
+
+
+def get_samples(values, names):
+    """Returns the (timestamp, value) samples of the first metric found."""
+    for name in names:
+        if values.get(name):
+            return sorted((float(entry["timestamp"]), float(entry["value"])) for entry in values[name])
+    return []
+
+
+cpu_times = {}
+print(f"{'device':<50} {'CPU time (s)':>14} {'peak RSS (MB)':>14}")
+for device, values in sorted(metrics.items()):
+    # integral of the CPU usage (percentage of one core) over the sampling intervals (timestamps in ms)
+    usage = get_samples(values, ["cpuUsedPercentage"])
+    cpu_time = sum(0.01 * value * 1.e-3 * (time - time_prev) for (time_prev, _), (time, value) in zip(usage, usage[1:]))
+    rss = get_samples(values, ["resident-set-size", "residentSetSize"])
+    peak = max((value for _, value in rss), default=0.)
+    cpu_times[device] = cpu_time
+    print(f"{device:<50} {cpu_time:>14.2f} {peak / 1024:>14.1f}")
+
+# CPU times of the devices whose throughput is reported
+devices = ["hf-tag-sel-tracks", "hf-track-index-skim-creator", "hf-candidate-creator2-prong"]
+missing = [device for device in devices if not cpu_times.get(device)]
+if missing:
+    sys.exit(f"Error: No CPU usage of {', '.join(missing)} in {path_metrics}, the run is too short for the monitoring interval.")
+with open(path_times, "w") as file:
+    file.write(" ".join(str(cpu_times[device]) for device in devices) + "\n")
+END
+
+  # report throughput per device
+  local time_sel time_skim time_cand
+  read -r time_sel time_skim time_cand < "cpuTimes_${mode}.txt"
+  root -b -q -l "$DIR_THIS/benchmarkReport.C(\"AnalysisResults_${mode}.root\", $time_sel, $time_skim, $time_cand)"
+}
+
+for mode in $MODES; do
+  run_mode "$mode" || exit 1
+done
@@ -0,0 +1,1701 @@
+// Copyright 2019-2020 CERN and copyright holders of ALICE O2.
+// See https://alice-o2.web.cern.ch/copyright for details of the copyright holders.
+// All rights not expressly granted are reserved.
+//
+// This software is distributed under the terms of the GNU General Public
+// License v3 (GPL Version 3), copied verbatim in the file "COPYING".
+//
+// In applying this license CERN does not waive the privileges and immunities
+// granted to it by virtue of its status as an Intergovernmental Organization
+// or submit itself to any jurisdiction.
+
+/// \file taskMini_opt.cxx
+/// \brief Mini version of the HF analysis chain (step 4) with optional performance features
+///
+/// \author Vít Kučera <vit.kucera@cern.ch>, Inha University
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Common/Core/RecoDecay.h"
+#include "Common/Core/TrackSelectorPID.h"
+#include "Common/Core/trackUtilities.h"
+#include "Common/DataModel/PIDResponse.h"
+#include "Common/DataModel/TrackSelectionTables.h"
+#include "DCAFitter/DCAFitterN.h"
+#include "Framework/AnalysisDataModel.h"
+#include "Framework/AnalysisTask.h"
+#include "Framework/HistogramRegistry.h"
+
+#include "PWGHF/Core/SelectorCuts.h"
+
+using namespace o2;
+using namespace o2::analysis;
+using namespace o2::aod;
+using namespace o2::framework;
+using namespace o2::framework::expressions;
+
+void customize(std::vector<o2::framework::ConfigParamSpec>& workflowOptions)
+{
+  ConfigParamSpec optionMaterialize{"materialize-columns", VariantType::Bool, false, {"Spawn stored columns of invariant masses, CPA and rapidity of 2-prong candidates."}};
+  workflowOptions.push_back(optionMaterialize);
+}
+
+#include "Framework/runDataProcessing.h"
+
+// Constants
+static const double massPi = RecoDecay::getMassPDG(kPiPlus);
+static const double massK = RecoDecay::getMassPDG(kKPlus);
+static const auto arrMassPiK = std::array{massPi, massK};
+static const auto arrMassKPi = std::array{massK, massPi};
+static const auto arrMassPiKPi = std::array{massPi, massK, massPi};
+
+// Track selection =====================================================================
+
+namespace o2::aod
+{
+namespace hf_seltrack
+{
+/// Candidate types for which a track is selected as a prong, one bit each in the IsSelProng word
+enum CandidateType {
+  Cand2Prong = 0,
+  NCandidateTypes
+};
+
+// Track selection columns
+DECLARE_SOA_COLUMN(IsSelProng, isSelProng, uint8_t); //! prong selection bits, one per CandidateType
+} // namespace hf_seltrack
+
+// Track selection table
+DECLARE_SOA_TABLE(HfSelTrack, "AOD", "HFSELTRACK", //! track selection table
+                  hf_seltrack::IsSelProng);
+
+namespace hf_coll_track_counts
+{
+// Collision track count columns
+DECLARE_SOA_COLUMN(NTracks, nTracks, int);       //! number of tracks of the collision
+DECLARE_SOA_COLUMN(NSelProngs, nSelProngs, int); //! number of tracks of the collision selected as 2-prong prongs
+} // namespace hf_coll_track_counts
+
+// Collision track count table (one row per collision, joinable with Collisions)
+DECLARE_SOA_TABLE(HfCollTrackCounts, "AOD", "HFCOLLTRKCNT", //! table with numbers of tracks per collision
+                  hf_coll_track_counts::NTracks,
+                  hf_coll_track_counts::NSelProngs);
+} // namespace o2::aod
+
+/// Track selection
+struct HfTagSelTracks {
+  Produces<aod::HfSelTrack> rowSelectedTrack;
+  Produces<aod::HfCollTrackCounts> rowCollTrackCounts;
+
+  // 2-prong cuts
+  Configurable<double> ptTrackMin{"ptTrackMin", -1., "min. track pT for 2 prong candidate"};
+  Configurable<double> etaTrackMax{"etaTrackMax", 4., "max. pseudorapidity for 2 prong candidate"};
+  Configurable<double> dcaTrackMin{"dcaTrackMin", 0.0025, "min. DCA for 2 prong candidate"};
+
+  using TracksWithDca = soa::Join<aod::Tracks, aod::TracksDCA>;
+
+  static constexpr int nTracksChunk = 1024; // number of tracks selected in one pass
+
+  // track variables of the current chunk, stored contiguously so that the selection loop can be vectorised
+  std::array<float, nTracksChunk> ptChunk{};
+  std::array<float, nTracksChunk> etaChunk{};
+  std::array<float, nTracksChunk> dcaXYChunk{};
+  std::array<uint8_t, nTracksChunk> statusChunk{};
+  std::array<int, nTracksChunk> collisionIdChunk{};
+
+  // numbers of tracks per collision of the current timeframe
+  std::vector<int> nTracksPerCollision;
+  std::vector<int> nSelProngsPerCollision;
+
+  // histogram values of the current chunk, filled in bulk
+  std::array<double, nTracksChunk> ptFill{};
+  std::array<double, nTracksChunk> ptSelFill{};
+  std::array<double, nTracksChunk> etaSelFill{};
+  std::array<double, nTracksChunk> dcaXYSelFill{};
+
+  HistogramRegistry registry{
+    "registry",
+    {}};
+
+  void init(o2::framework::InitContext&)
+  {
+    const TString strTitle = "D^{0} candidates";
+    const TString strPt = "#it{p}_{T}^{track} (GeV/#it{c})";
+    const TString strEntries = "entries";
+    registry.add("hPtNoCuts", "all tracks;" + strPt + ";" + strEntries, {HistType::kTH1F, {{100, 0., 10.}}});
+    registry.add("hPtCuts2Prong", "tracks selected for 2-prong vertexing;" + strPt + ";" + strEntries, {HistType::kTH1F, {{100, 0., 10.}}});
+    registry.add("hPtVsDcaXYToPvCuts2Prong", "tracks selected for 2-prong vertexing;" + strPt + ";" + "DCAxy to prim. vtx. (cm)" + ";" + strEntries, {HistType::kTH2F, {{100, 0., 10.}, {400, -2., 2.}}});
+    registry.add("hEtaCuts2Prong", "tracks selected for 2-prong vertexing;#it{#eta};" + strEntries, {HistType::kTH1F, {{static_cast<int>(1.2 * etaTrackMax * 100), -1.2 * etaTrackMax, 1.2 * etaTrackMax}}});
+  }
+
+  /// Evaluates the cuts of all tracks of the chunk without branches
+  /// \param nTracks number of tracks in the chunk
+  void selectChunk(int nTracks)
+  {
+    const double ptMin = ptTrackMin;
+    const double etaMax = etaTrackMax;
+    const double dcaMin = dcaTrackMin;
+    for (int i = 0; i < nTracks; ++i) {
+      // negated comparisons reject the same tracks as the per-cut checks, including NaN
+      bool isSel2Prong = !(ptChunk[i] < ptMin) & !(std::abs(etaChunk[i]) > etaMax) & !(std::abs(dcaXYChunk[i]) < dcaMin);
+      statusChunk[i] = static_cast<uint8_t>(isSel2Prong) << aod::hf_seltrack::Cand2Prong;
+    }
+  }
+
+  /// Fills the histograms and the table rows of the tracks of the chunk
+  /// \param nTracks number of tracks in the chunk
+  void fillChunk(int nTracks)
+  {
+    int nTracksSel = 0;
+    for (int i = 0; i < nTracks; ++i) {
+      ptFill[i] = ptChunk[i];
+      // compact the values of the selected tracks without branches
+      ptSelFill[nTracksSel] = ptChunk[i];
+      etaSelFill[nTracksSel] = etaChunk[i];
+      dcaXYSelFill[nTracksSel] = dcaXYChunk[i];
+      nTracksSel += TESTBIT(statusChunk[i], aod::hf_seltrack::Cand2Prong) ? 1 : 0;
+      rowSelectedTrack(statusChunk[i]);
+      // count the tracks per collision
+      if (collisionIdChunk[i] >= 0) {
+        ++nTracksPerCollision[collisionIdChunk[i]];
+        nSelProngsPerCollision[collisionIdChunk[i]] += TESTBIT(statusChunk[i], aod::hf_seltrack::Cand2Prong) ? 1 : 0;
+      }
+    }
+    // FillN updates the contents, the entries and the statistics as Fill called for each value
+    registry.get<TH1>(HIST("hPtNoCuts"))->FillN(nTracks, ptFill.data(), nullptr);
+    registry.get<TH1>(HIST("hPtCuts2Prong"))->FillN(nTracksSel, ptSelFill.data(), nullptr);
+    registry.get<TH1>(HIST("hEtaCuts2Prong"))->FillN(nTracksSel, etaSelFill.data(), nullptr);
+    registry.get<TH2>(HIST("hPtVsDcaXYToPvCuts2Prong"))->FillN(nTracksSel, ptSelFill.data(), dcaXYSelFill.data(), nullptr);
+  }
+
+  /// \note Takes the whole collision and track tables, so that the tracks are counted per collision without grouping.
+  void process(aod::Collisions const& collisions, TracksWithDca const& tracks)
+  {
+    nTracksPerCollision.assign(collisions.size(), 0);
+    nSelProngsPerCollision.assign(collisions.size(), 0);
+    rowSelectedTrack.reserve(tracks.size());
+    rowCollTrackCounts.reserve(collisions.size());
+
+    int nTracks = 0;
+    for (auto const& track : tracks) {
+      collisionIdChunk[nTracks] = track.collisionId();
+      ptChunk[nTracks] = track.pt();
+      etaChunk[nTracks] = track.eta();
+      dcaXYChunk[nTracks] = track.dcaXY();
+      if (++nTracks == nTracksChunk) {
+        selectChunk(nTracks);
+        fillChunk(nTracks);
+        nTracks = 0;
+      }
+    }
+    selectChunk(nTracks);
+    fillChunk(nTracks);
+
+    // fill the collision table rows
+    for (size_t iCollision = 0; iCollision < nTracksPerCollision.size(); ++iCollision) {
+      rowCollTrackCounts(nTracksPerCollision[iCollision], nSelProngsPerCollision[iCollision]);
+    }
+  }
+};
+
+// Track PID =====================================================================
+
+namespace o2::aod
+{
+namespace hf_pidtrack
+{
+/// Species with a stored PID status
+enum PidSpecies {
+  Pion = 0,
+  Kaon,
+  Proton,
+  NPidSpecies
+};
+
+static constexpr int nBitsPidStatus = 2; // number of bits per TrackSelectorPID status
+
+// Track PID columns
+DECLARE_SOA_COLUMN(PidStatus, pidStatus, uint8_t); //! TrackSelectorPID TPC-or-TOF statuses, nBitsPidStatus bits per species
+
+/// Packs the PID status of a species into the PID status word
+/// \param word PID status word
+/// \param species species
+/// \param status TrackSelectorPID status
+inline void setPidStatus(uint8_t& word, PidSpecies species, int status)
+{
+  word |= static_cast<uint8_t>(status << (nBitsPidStatus * species));
+}
+
+/// Gets the PID status of a species of a track
+/// \param track track joined with the HfPidTrack table
+/// \param species species
+/// \return TrackSelectorPID status
+template <typename T>
+int getPidStatus(const T& track, PidSpecies species)
+{
+  return (track.pidStatus() >> (nBitsPidStatus * species)) & ((1 << nBitsPidStatus) - 1);
+}
+} // namespace hf_pidtrack
+
+// Track PID table
+DECLARE_SOA_TABLE(HfPidTrack, "AOD", "HFPIDTRACK", //! track PID status table
+                  hf_pidtrack::PidStatus);
+} // namespace o2::aod
+
+/// Track PID
+/// Evaluates the PID status of the selected tracks once per track, so that the candidate selectors
+/// do not repeat it for every candidate the track belongs to.
+struct HfTagPidTracks {
+  Produces<aod::HfPidTrack> rowPidTrack;
+
+  // TPC
+  Configurable<double> ptPidTpcMin{"ptPidTpcMin", 0.15, "Lower bound of track pT for TPC PID"};
+  Configurable<double> ptPidTpcMax{"ptPidTpcMax", 5., "Upper bound of track pT for TPC PID"};
+  Configurable<double> nSigmaTpc{"nSigmaTpc", 3., "Nsigma cut on TPC only"};
+
+  using TracksWithPid = soa::Join<Tracks, aod::HfSelTrack,
+                                  aod::pidTPCFullEl, aod::pidTPCFullMu, aod::pidTPCFullPi, aod::pidTPCFullKa, aod::pidTPCFullPr,
+                                  aod::pidTOFFullEl, aod::pidTOFFullMu, aod::pidTOFFullPi, aod::pidTOFFullKa, aod::pidTOFFullPr>;
+
+  void process(TracksWithPid const& tracks)
+  {
+    TrackSelectorPID selectorPion(kPiPlus);
+    selectorPion.setRangePtTPC(ptPidTpcMin, ptPidTpcMax);
+    selectorPion.setRangeNSigmaTPC(-nSigmaTpc, nSigmaTpc);
+
+    TrackSelectorPID selectorKaon(selectorPion);
+    selectorKaon.setPDG(kKPlus);
+
+    TrackSelectorPID selectorProton(selectorPion);
+    selectorProton.setPDG(kProton);
+
+    rowPidTrack.reserve(tracks.size());
+    for (auto const& track : tracks) {
+      uint8_t pidStatus = 0;
+      // only tracks selected as prongs can be candidate daughters
+      if (TESTBIT(track.isSelProng(), aod::hf_seltrack::Cand2Prong)) {
+        hf_pidtrack::setPidStatus(pidStatus, hf_pidtrack::Pion, selectorPion.getStatusTrackPIDTpcOrTof(track));
+        hf_pidtrack::setPidStatus(pidStatus, hf_pidtrack::Kaon, selectorKaon.getStatusTrackPIDTpcOrTof(track));
+        hf_pidtrack::setPidStatus(pidStatus, hf_pidtrack::Proton, selectorProton.getStatusTrackPIDTpcOrTof(track));
+      }
+      rowPidTrack(pidStatus);
+    }
+  }
+};
+
+// Track index skimming =====================================================================
+
+namespace o2::aod
+{
+namespace hf_track_index
+{
+// Track index skim columns
+DECLARE_SOA_INDEX_COLUMN_FULL(Prong0, prong0, int, Tracks, "_0"); //! prong 0
+DECLARE_SOA_INDEX_COLUMN_FULL(Prong1, prong1, int, Tracks, "_1"); //! prong 1
+DECLARE_SOA_INDEX_COLUMN_FULL(Prong2, prong2, int, Tracks, "_2"); //! prong 2
+} // namespace hf_track_index
+
+// Track index skim tables
+DECLARE_SOA_TABLE(HfTrackIndexProng2, "AOD", "HFTRACKIDXP2", //! table with prongs indices
+                  hf_track_index::Prong0Id,
+                  hf_track_index::Prong1Id);
+
+DECLARE_SOA_TABLE(HfTrackIndexProng3, "AOD", "HFTRACKIDXP3", //! table with 3-prong indices
+                  hf_track_index::Prong0Id,
+                  hf_track_index::Prong1Id,
+                  hf_track_index::Prong2Id);
+
+namespace hf_track_index_fit
+{
+// Vertex fit result columns
+DECLARE_SOA_COLUMN(XPca, xPca, float);         //! x coordinate of the PCA
+DECLARE_SOA_COLUMN(YPca, yPca, float);         //! y coordinate of the PCA
+DECLARE_SOA_COLUMN(ZPca, zPca, float);         //! z coordinate of the PCA
+DECLARE_SOA_COLUMN(PxProng0, pxProng0, float); //! px of prong 0 at the PCA
+DECLARE_SOA_COLUMN(PyProng0, pyProng0, float); //! py of prong 0 at the PCA
+DECLARE_SOA_COLUMN(PzProng0, pzProng0, float); //! pz of prong 0 at the PCA
+DECLARE_SOA_COLUMN(PxProng1, pxProng1, float); //! px of prong 1 at the PCA
+DECLARE_SOA_COLUMN(PyProng1, pyProng1, float); //! py of prong 1 at the PCA
+DECLARE_SOA_COLUMN(PzProng1, pzProng1, float); //! pz of prong 1 at the PCA
+DECLARE_SOA_COLUMN(Chi2Pca, chi2Pca, float);   //! chi2 at the PCA
+} // namespace hf_track_index_fit
+
+// Vertex fit result table (one row per row of HfTrackIndexProng2)
+DECLARE_SOA_TABLE(HfTrackIndexProng2Fit, "AOD", "HFTRKIDXP2FIT", //! table with 2-prong vertex fit results
+                  hf_track_index_fit::XPca, hf_track_index_fit::YPca, hf_track_index_fit::ZPca,
+                  hf_track_index_fit::PxProng0, hf_track_index_fit::PyProng0, hf_track_index_fit::PzProng0,
+                  hf_track_index_fit::PxProng1, hf_track_index_fit::PyProng1, hf_track_index_fit::PzProng1,
+                  hf_track_index_fit::Chi2Pca);
+} // namespace o2::aod
+
+namespace hf_fitter_qa
+{
+// Fit statuses of DCAFitterN (o2::vertexing::FitStatus), the last bin collects unknown values
+static constexpr int nFitStatuses = 14;
+static const std::vector<std::string> labelsFitStatus = {"None", "Converged", "MaxIter", "NoCrossing", "RejRadius", "RejTrackX", "RejTrackRoughZ",
+                                                         "RejChi2Max", "FailProp", "FailInvCov", "FailInvWeight", "FailInv2ndDeriv", "FailCorrTracks", "FailCloserAlt", "other"};
+
+/// Record of one vertex fit
+struct FitterCall {
+  int nCandidates{0}; ///< number of PCA candidates
+  int nIterations{0}; ///< number of iterations of the best candidate
+  int status{0};      ///< fit status of the best candidate
+  float time{0.f};    ///< wall time of the fit (µs)
+};
+
+/// Runs the vertex fit and records it
+/// \param fitter vertex fitter
+/// \param calls records of the fits (appended)
+/// \param tracks track parametrisations of the prongs
+/// \return number of PCA candidates
+template <typename TFitter, typename... TTracks>
+int processAndRecord(TFitter& fitter, std::vector<FitterCall>& calls, const TTracks&... tracks)
+{
+  auto start = std::chrono::steady_clock::now();
+  int nCandidates = fitter.process(tracks...);
+  auto stop = std::chrono::steady_clock::now();
+  auto& call = calls.emplace_back();
+  call.nCandidates = nCandidates;
+  call.nIterations = fitter.getNIterations();
+  call.status = std::clamp(static_cast<int>(fitter.getFitStatus()), 0, nFitStatuses);
+  call.time = std::chrono::duration<float, std::micro>(stop - start).count();
+  return nCandidates;
+}
+
+/// Summary of all vertex fits of a device, printed at the end of the stream
+struct FitterSummary {
+  int64_t nCalls{0};                                    ///< number of fits
+  int64_t nCallsWithCandidates{0};                      ///< number of fits with at least one PCA candidate
+  int64_t nIterations{0};                               ///< total number of iterations
+  double time{0.};                                      ///< total wall time (µs)
+  std::array<int64_t, nFitStatuses + 1> countsStatus{}; ///< numbers of fits per status
+
+  void print(const std::string& name) const
+  {
+    LOGF(info, "%s: vertex fitter summary: %ld fits, %ld with candidates", name, nCalls, nCallsWithCandidates);
+    if (nCalls == 0) {
+      return;
+    }
+    LOGF(info, "%s: mean number of iterations %.2f, mean time %.2f µs, total time %.3f s", name,
+         static_cast<double>(nIterations) / nCalls, time / nCalls, 1.e-6 * time);
+    for (int iStatus = 0; iStatus <= nFitStatuses; ++iStatus) {
+      if (countsStatus[iStatus] > 0) {
+        LOGF(info, "%s: status %s: %ld fits (%.2f %%)", name, labelsFitStatus[iStatus], countsStatus[iStatus], 100. * countsStatus[iStatus] / nCalls);
+      }
+    }
+  }
+};
+
+/// Adds the fitter histograms to a registry
+/// \param registry histogram registry
+inline void addHistograms(HistogramRegistry& registry)
+{
+  registry.add("hFitterNCandidates", "vertex fits;number of PCA candidates;entries", {HistType::kTH1F, {{4, -0.5, 3.5}}});
+  registry.add("hFitterNIterations", "vertex fits;number of iterations;entries", {HistType::kTH1F, {{51, -0.5, 50.5}}});
+  registry.add("hFitterStatus", "vertex fits;fit status;entries", {HistType::kTH1F, {{nFitStatuses + 1, -0.5, nFitStatuses + 0.5}}});
+  registry.add("hFitterTime", "vertex fits;wall time (#mus);entries", {HistType::kTH1F, {{200, 0., 200.}}});
+  registry.add("hFitterNIterationsVsStatus", "vertex fits;fit status;number of iterations;entries", {HistType::kTH2F, {{nFitStatuses + 1, -0.5, nFitStatuses + 0.5}, {51, -0.5, 50.5}}});
+  auto hStatus = registry.get<TH1>(HIST("hFitterStatus"));
+  auto hNIterationsVsStatus = registry.get<TH2>(HIST("hFitterNIterationsVsStatus"));
+  for (int iBin = 0; iBin <= nFitStatuses; ++iBin) {
+    hStatus->GetXaxis()->SetBinLabel(iBin + 1, labelsFitStatus[iBin].data());
+    hNIterationsVsStatus->GetXaxis()->SetBinLabel(iBin + 1, labelsFitStatus[iBin].data());
+  }
+}
+
+/// Fills the fitter histograms and the summary
+/// \param registry histogram registry
+/// \param summary summary (incremented)
+/// \param calls records of the fits
+inline void fill(HistogramRegistry& registry, FitterSummary& summary, const std::vector<FitterCall>& calls)
+{
+  for (const auto& call : calls) {
+    registry.fill(HIST("hFitterNCandidates"), call.nCandidates);
+    registry.fill(HIST("hFitterNIterations"), call.nIterations);
+    registry.fill(HIST("hFitterStatus"), call.status);
+    registry.fill(HIST("hFitterTime"), call.time);
+    registry.fill(HIST("hFitterNIterationsVsStatus"), call.status, call.nIterations);
+    ++summary.nCalls;
+    summary.nCallsWithCandidates += call.nCandidates > 0 ? 1 : 0;
+    summary.nIterations += call.nIterations;
+    summary.time += call.time;
+    ++summary.countsStatus[call.status];
+  }
+}
+} // namespace hf_fitter_qa
+
+namespace hf_track_buffer
+{
+/// Circle of a track in the transverse plane
+struct TrackCircle {
+  float xC{0.f}; ///< x of the circle centre
+  float yC{0.f}; ///< y of the circle centre
+  float rC{0.f}; ///< circle radius
+};
+
+/// Calculates the circle of a track in the transverse plane
+/// \param trackParVar track parametrisation
+/// \param bz magnetic field
+/// \return circle parameters
+template <typename T>
+TrackCircle getTrackCircle(const T& trackParVar, float bz)
+{
+  o2::math_utils::CircleXYf_t circle;
+  float sna, csa;
+  trackParVar.getCircleParams(bz, circle, sna, csa);
+  return {circle.xC, circle.yC, circle.rC};
+}
+
+/// Contiguous (structure-of-arrays) buffer of tracks prepared for pairing
+struct TrackBuffer {
+  std::vector<o2::track::TrackParCov> trackParVars; ///< track parametrisations with covariance
+  std::vector<TrackCircle> circles;                 ///< circles in the transverse plane (only for the 3-prong skim)
+  std::vector<int64_t> globalIndices;               ///< global indices of the tracks
+
+  void clear()
+  {
+    trackParVars.clear();
+    circles.clear();
+    globalIndices.clear();
+  }
+
+  size_t size() const { return globalIndices.size(); }
+};
+
+/// Builder of per-collision track buffers split by charge
+/// The buffers keep their capacity between collisions, so memory is allocated only when the multiplicity grows.
+struct TrackBuffersByCharge {
+  TrackBuffer positive; ///< positive tracks
+  TrackBuffer negative; ///< negative tracks
+
+  void clear()
+  {
+    positive.clear();
+    negative.clear();
+  }
+
+  /// Adds a track to the buffer of its charge
+  /// \param track track
+  /// \param bz magnetic field
+  /// \param withCircles whether to store the track circle
+  template <typename T>
+  void add(const T& track, float bz, bool withCircles)
+  {
+    auto& buffer = track.signed1Pt() < 0 ? negative : positive;
+    auto trackParVar = getTrackParCov(track);
+    if (withCircles) {
+      buffer.circles.push_back(getTrackCircle(trackParVar, bz));
+    }
+    buffer.trackParVars.push_back(std::move(trackParVar));
+    buffer.globalIndices.push_back(track.globalIndex());
+  }
+
+  /// Splits the tracks of one collision into the positive and negative buffers
+  /// \param tracks tracks of the collision
+  /// \param bz magnetic field
+  /// \param withCircles whether to store the track circles
+  template <typename T>
+  void fill(const T& tracks, float bz, bool withCircles)
+  {
+    clear();
+    for (auto const& track : tracks) {
+      add(track, bz, withCircles);
+    }
+  }
+};
+
+/// Result of an accepted 2-prong vertex fit
+struct Prong2Result {
+  int64_t prong0Id{-1};                   ///< global index of prong 0
+  int64_t prong1Id{-1};                   ///< global index of prong 1
+  std::array<float, 3> secondaryVertex{}; ///< position of the PCA
+  std::array<float, 3> pVec0{};           ///< momentum of prong 0 at the PCA
+  std::array<float, 3> pVec1{};           ///< momentum of prong 1 at the PCA
+  float chi2Pca{0.f};                     ///< chi2 at the PCA
+  int indexPos{-1};                       ///< index of the positive track in the collision buffer
+  int indexNeg{-1};                       ///< index of the negative track in the collision buffer
+};
+
+/// Result of an accepted 3-prong vertex fit
+/// Prong 1 has the opposite charge to prongs 0 and 2.
+struct Prong3Result {
+  int64_t prong0Id{-1};                   ///< global index of prong 0
+  int64_t prong1Id{-1};                   ///< global index of prong 1
+  int64_t prong2Id{-1};                   ///< global index of prong 2
+  std::array<float, 3> secondaryVertex{}; ///< position of the PCA
+  std::array<float, 3> pVec0{};           ///< momentum of prong 0 at the PCA
+  std::array<float, 3> pVec1{};           ///< momentum of prong 1 at the PCA
+  std::array<float, 3> pVec2{};           ///< momentum of prong 2 at the PCA
+};
+
+/// Pairing output of one collision
+struct CollisionPairs {
+  std::vector<Prong2Result> results;                 ///< accepted pairs
+  int64_t nPairs{0};                                 ///< number of tested pairs
+  std::vector<Prong3Result> results3Prong;           ///< accepted triplets
+  std::vector<hf_fitter_qa::FitterCall> fitterCalls; ///< records of the vertex fits (only with fillFitterQa)
+
+  void clear()
+  {
+    results.clear();
+    nPairs = 0;
+    results3Prong.clear();
+    fitterCalls.clear();
+  }
+};
+
+/// Per-timeframe cache of track parametrisations keyed by the global track index
+/// Each track is converted at most once per timeframe, however many pairs it belongs to.
+/// The storage is sized for the whole track table and keeps its capacity between timeframes.
+struct TrackParCovCache {
+  std::vector<o2::track::TrackParCov> trackParVars; ///< cached track parametrisations
+  std::vector<uint8_t> isCached;                    ///< flags of converted tracks
+
+  /// Invalidates the cache for a new timeframe
+  /// \param tracks full (unfiltered) track table of the timeframe
+  template <typename T>
+  void reset(const T& tracks)
+  {
+    trackParVars.resize(tracks.size());
+    isCached.assign(tracks.size(), 0);
+  }
+
+  /// Returns the track parametrisation, converting the track at first access
+  /// \param track track
+  /// \return track parametrisation with covariance
+  template <typename T>
+  const o2::track::TrackParCov& get(const T& track)
+  {
+    auto index = track.globalIndex();
+    if (!isCached[index]) {
+      trackParVars[index] = getTrackParCov(track);
+      isCached[index] = 1;
+    }
+    return trackParVars[index];
+  }
+};
+} // namespace hf_track_buffer
+
+/// Track index skim creator
+/// Pre-selection of 2-prong secondary vertices
+/// \note The tracks are paired within the collision they are assigned to (collisionId), and each track has exactly one collision.
+///       A pair can therefore be reached from one collision only and is never fitted or written twice.
+///       Tracks compatible with several collisions (track-to-collision association tables) are not used here.
+struct HfTrackIndexSkimCreator {
+  Produces<aod::HfTrackIndexProng2> rowTrackIndexProng2;
+  Produces<aod::HfTrackIndexProng2Fit> rowTrackIndexProng2Fit;
+  Produces<aod::HfTrackIndexProng3> rowTrackIndexProng3;
+
+  // vertexing parameters
+  Configurable<double> magneticField{"magneticField", 5., "magnetic field [kG]"};
+  Configurable<bool> propToDCA{"propToDCA", true, "create tracks version propagated to PCA"};
+  Configurable<bool> useAbsDCA{"useAbsDCA", true, "Minimise abs. distance rather than chi2"};
+  Configurable<double> maxR{"maxR", 200., "reject PCA's above this radius"};
+  Configurable<double> maxDZIni{"maxDZIni", 4., "reject (if>0) PCA candidate if tracks DZ exceeds threshold"};
+  Configurable<double> minParamChange{"minParamChange", 1.e-3, "stop iterations if largest change of any X is smaller than this"};
+  Configurable<double> minRelChi2Change{"minRelChi2Change", 0.9, "stop iterations if chi2/chi2old > this"};
+  // 3-prong
+  Configurable<bool> do3Prong{"do3Prong", false, "build 3-prong track index rows seeded from the accepted 2-prong pairs"};
+  Configurable<double> maxDistPca3Prong{"maxDistPca3Prong", 0.2, "3-prong: max. transverse distance of the third track circle from the 2-prong PCA (cm)"};
+  // output
+  Configurable<bool> fillFitResults{"fillFitResults", false, "store the vertex fit results so that the candidate creator does not need to refit"};
+  Configurable<bool> fillFitterQa{"fillFitterQa", false, "record iterations, status, time and number of PCA candidates of each vertex fit"};
+  // parallelism
+  Configurable<int> nThreads{"nThreads", 4, "number of threads pairing the collisions of a timeframe in processParallel"};
+
+  using SelectedTracks = soa::Filtered<soa::Join<aod::Tracks, aod::TracksCov, aod::HfSelTrack>>;
+
+  Filter filterSelectTracks = (aod::hf_seltrack::isSelProng & static_cast<uint8_t>(BIT(aod::hf_seltrack::Cand2Prong))) != static_cast<uint8_t>(0);
+
+  hf_track_buffer::TrackBuffersByCharge trackBuffers; // per-collision track buffers, reused between collisions
+  hf_track_buffer::CollisionPairs pairs;              // pairing output of the current collision
+  // vertex fitters and flags of the accepted pairs, one set per thread (processSerial uses the first one)
+  std::vector<o2::vertexing::DCAFitterN<2>> fitters2Prong;
+  std::vector<o2::vertexing::DCAFitterN<3>> fitters3Prong; // only with do3Prong
+  std::vector<std::vector<uint8_t>> isPairAcceptedPerThread;
+  // buffers for the parallel processing of the collisions of one timeframe
+  std::vector<hf_track_buffer::TrackBuffersByCharge> trackBuffersPerCollision;
+  std::vector<hf_track_buffer::CollisionPairs> pairsPerCollision;
+  hf_fitter_qa::FitterSummary fitterSummary; // summary of the vertex fits, printed at the end of the stream
+
+  HistogramRegistry registry{
+    "registry",
+    {// 2-prong histograms
+     {"hVtx2ProngX", "2-prong candidates;#it{x}_{sec. vtx.} (cm);entries", {HistType::kTH1F, {{1000, -2., 2.}}}},
+     {"hVtx2ProngY", "2-prong candidates;#it{y}_{sec. vtx.} (cm);entries", {HistType::kTH1F, {{1000, -2., 2.}}}},
+     {"hVtx2ProngZ", "2-prong candidates;#it{z}_{sec. vtx.} (cm);entries", {HistType::kTH1F, {{1000, -20., 20.}}}},
+     {"hMassD0ToPiK", "D^{0} candidates;inv. mass (#pi K) (GeV/#it{c}^{2});entries", {HistType::kTH1F, {{500, 0., 5.}}}},
+     {"hNPairs2Prong", "2-prong pairs;;tested pairs", {HistType::kTH1D, {{1, 0., 1.}}}},
+     // 3-prong histograms
+     {"hVtx3ProngX", "3-prong candidates;#it{x}_{sec. vtx.} (cm);entries", {HistType::kTH1F, {{1000, -2., 2.}}}},
+     {"hVtx3ProngY", "3-prong candidates;#it{y}_{sec. vtx.} (cm);entries", {HistType::kTH1F, {{1000, -2., 2.}}}},
+     {"hVtx3ProngZ", "3-prong candidates;#it{z}_{sec. vtx.} (cm);entries", {HistType::kTH1F, {{1000, -20., 20.}}}},
+     {"hMassDPlusToPiKPi", "D^{#plus} candidates;inv. mass (#pi K #pi) (GeV/#it{c}^{2});entries", {HistType::kTH1F, {{500, 0., 5.}}}}}};
+
+  void init(o2::framework::InitContext& initContext)
+  {
+    if (doprocessSerial && doprocessParallel) {
+      LOGF(fatal, "Cannot enable processSerial and processParallel at the same time. Please choose one.");
+    }
+
+    // the fitters are configured once and reused for all collisions
+    auto nThreadsFit = doprocessParallel ? std::max(1, nThreads.value) : 1;
+    fitters2Prong.resize(nThreadsFit);
+    for (auto& df2 : fitters2Prong) {
+      configureFitter(df2);
+    }
+    if (do3Prong) {
+      fitters3Prong.resize(nThreadsFit);
+      for (auto& df3 : fitters3Prong) {
+        configureFitter(df3);
+      }
+    }
+    isPairAcceptedPerThread.resize(nThreadsFit);
+
+    if (fillFitterQa) {
+      hf_fitter_qa::addHistograms(registry);
+      initContext.services().get<CallbackService>().set<CallbackService::Id::EndOfStream>([this](EndOfStreamContext&) { fitterSummary.print("hf-track-index-skim-creator"); });
+    }
+  }
+
+  /// Applies the vertexing parameters to a fitter
+  /// \param df vertex fitter
+  template <typename TFitter>
+  void configureFitter(TFitter& df)
+  {
+    df.setBz(magneticField);
+    df.setPropagateToPCA(propToDCA);
+    df.setMaxR(maxR);
+    df.setMaxDZIni(maxDZIni);
+    df.setMinParamChange(minParamChange);
+    df.setMinRelChi2Change(minRelChi2Change);
+    df.setUseAbsDCA(useAbsDCA);
+  }
+
+  /// Pairs the positive and negative tracks of one collision and fits the 2-prong vertices
+  /// \note Does not touch the task outputs, so it can be called concurrently for different collisions with different threads.
+  /// \param buffers tracks of the collision split by charge
+  /// \param iThread index of the thread (selects the fitters and the buffer of accepted pairs)
+  /// \param output accepted pairs and triplets
+  void makePairs(const hf_track_buffer::TrackBuffersByCharge& buffers,
+                 int iThread,
+                 hf_track_buffer::CollisionPairs& output)
+  {
+    const auto& tracksPos = buffers.positive;
+    const auto& tracksNeg = buffers.negative;
+    output.nPairs = tracksPos.size() * tracksNeg.size();
+    auto& df2 = fitters2Prong[iThread];
+    auto& isAccepted = isPairAcceptedPerThread[iThread];
+    if (do3Prong) {
+      isAccepted.assign(tracksPos.size() * tracksNeg.size(), 0);
+    }
+
+    // loop over positive tracks
+    for (size_t iPos1 = 0; iPos1 < tracksPos.size(); ++iPos1) {
+      const auto& trackParVarPos1 = tracksPos.trackParVars[iPos1];
+
+      // loop over negative tracks
+      for (size_t iNeg1 = 0; iNeg1 < tracksNeg.size(); ++iNeg1) {
+        const auto& trackParVarNeg1 = tracksNeg.trackParVars[iNeg1];
+
+        // secondary vertex reconstruction and further 2-prong selections
+        auto nCandidates = fillFitterQa ? hf_fitter_qa::processAndRecord(df2, output.fitterCalls, trackParVarPos1, trackParVarNeg1) : df2.process(trackParVarPos1, trackParVarNeg1);
+        if (nCandidates == 0) {
+          continue;
+        }
+        auto& result = output.results.emplace_back();
+        result.prong0Id = tracksPos.globalIndices[iPos1];
+        result.prong1Id = tracksNeg.globalIndices[iNeg1];
+        //  get secondary vertex
+        const auto& secondaryVertex = df2.getPCACandidate();
+        result.secondaryVertex = {static_cast<float>(secondaryVertex[0]), static_cast<float>(secondaryVertex[1]), static_cast<float>(secondaryVertex[2])};
+        // get track momenta
+        df2.getTrack(0).getPxPyPzGlo(result.pVec0);
+        df2.getTrack(1).getPxPyPzGlo(result.pVec1);
+        result.chi2Pca = df2.getChi2AtPCACandidate();
+        result.indexPos = static_cast<int>(iPos1);
+        result.indexNeg = static_cast<int>(iNeg1);
+        if (do3Prong) {
+          isAccepted[iPos1 * tracksNeg.size() + iNeg1] = 1;
+        }
+      }
+    }
+
+    if (do3Prong) {
+      makeTriplets(buffers, fitters3Prong[iThread], isAccepted, output);
+    }
+  }
+
+  /// Checks whether the circle of a track passes close to the PCA of a pair in the transverse plane
+  /// \param circle circle of the track
+  /// \param secondaryVertex PCA of the pair
+  bool isNearPca(const hf_track_buffer::TrackCircle& circle, const std::array<float, 3>& secondaryVertex)
+  {
+    auto distCentre = RecoDecay::sqrtSumOfSquares(secondaryVertex[0] - circle.xC, secondaryVertex[1] - circle.yC);
+    return std::abs(distCentre - circle.rC) < maxDistPca3Prong;
+  }
+
+  /// Fits a triplet and stores it if the fit succeeds
+  /// \param df3 3-prong vertex fitter
+  /// \param trackParVar0 track parametrisation of prong 0
+  /// \param trackParVar1 track parametrisation of prong 1 (opposite charge)
+  /// \param trackParVar2 track parametrisation of prong 2
+  /// \param prongIds global indices of the prongs
+  /// \param output accepted triplets
+  void fitTriplet(o2::vertexing::DCAFitterN<3>& df3,
+                  const o2::track::TrackParCov& trackParVar0, const o2::track::TrackParCov& trackParVar1, const o2::track::TrackParCov& trackParVar2,
+                  const std::array<int64_t, 3>& prongIds,
+                  hf_track_buffer::CollisionPairs& output)
+  {
+    if (df3.process(trackParVar0, trackParVar1, trackParVar2) == 0) {
+      return;
+    }
+    auto& result = output.results3Prong.emplace_back();
+    result.prong0Id = prongIds[0];
+    result.prong1Id = prongIds[1];
+    result.prong2Id = prongIds[2];
+    const auto& secondaryVertex = df3.getPCACandidate();
+    result.secondaryVertex = {static_cast<float>(secondaryVertex[0]), static_cast<float>(secondaryVertex[1]), static_cast<float>(secondaryVertex[2])};
+    df3.getTrack(0).getPxPyPzGlo(result.pVec0);
+    df3.getTrack(1).getPxPyPzGlo(result.pVec1);
+    df3.getTrack(2).getPxPyPzGlo(result.pVec2);
+  }
+
+  /// Builds the 3-prong vertices of one collision from its accepted pairs
+  /// The third prong must have the charge of one of the seed prongs, must form an accepted pair with the other seed prong
+  /// and its circle must pass within maxDistPca3Prong of the seed PCA, so only a small fraction of the triplets is fitted.
+  /// The third prong is taken after the same-sign seed prong in the buffer, so that each triplet is built once.
+  /// \param buffers tracks of the collision split by charge
+  /// \param df3 3-prong vertex fitter
+  /// \param isAccepted flags of the accepted pairs (positive × negative)
+  /// \param output accepted pairs (input) and triplets (output)
+  void makeTriplets(const hf_track_buffer::TrackBuffersByCharge& buffers,
+                    o2::vertexing::DCAFitterN<3>& df3,
+                    const std::vector<uint8_t>& isAccepted,
+                    hf_track_buffer::CollisionPairs& output)
+  {
+    const auto& tracksPos = buffers.positive;
+    const auto& tracksNeg = buffers.negative;
+    const auto nNeg = tracksNeg.size();
+
+    for (const auto& pair : output.results) {
+      const auto& trackParVarPos1 = tracksPos.trackParVars[pair.indexPos];
+      const auto& trackParVarNeg1 = tracksNeg.trackParVars[pair.indexNeg];
+
+      // + - + triplets
+      for (size_t iPos2 = pair.indexPos + 1; iPos2 < tracksPos.size(); ++iPos2) {
+        if (!isAccepted[iPos2 * nNeg + pair.indexNeg] || !isNearPca(tracksPos.circles[iPos2], pair.secondaryVertex)) {
+          continue;
+        }
+        fitTriplet(df3, trackParVarPos1, trackParVarNeg1, tracksPos.trackParVars[iPos2],
+                   {pair.prong0Id, pair.prong1Id, tracksPos.globalIndices[iPos2]}, output);
+      }
+
+      // - + - triplets
+      for (size_t iNeg2 = pair.indexNeg + 1; iNeg2 < nNeg; ++iNeg2) {
+        if (!isAccepted[pair.indexPos * nNeg + iNeg2] || !isNearPca(tracksNeg.circles[iNeg2], pair.secondaryVertex)) {
+          continue;
+        }
+        fitTriplet(df3, trackParVarNeg1, trackParVarPos1, tracksNeg.trackParVars[iNeg2],
+                   {pair.prong1Id, pair.prong0Id, tracksNeg.globalIndices[iNeg2]}, output);
+      }
+    }
+  }
+
+  /// Fills the table rows and the histograms of one collision
+  /// \param output accepted pairs and triplets of the collision
+  void fillOutput(const hf_track_buffer::CollisionPairs& output)
+  {
+    for (const auto& result : output.results) {
+      const auto& secondaryVertex = result.secondaryVertex;
+      const auto& pVec0 = result.pVec0;
+      const auto& pVec1 = result.pVec1;
+
+      // fill table row
+      rowTrackIndexProng2(result.prong0Id,
+                          result.prong1Id);
+      if (fillFitResults) {
+        rowTrackIndexProng2Fit(secondaryVertex[0], secondaryVertex[1], secondaryVertex[2],
+                               pVec0[0], pVec0[1], pVec0[2],
+                               pVec1[0], pVec1[1], pVec1[2],
+                               result.chi2Pca);
+      }
+
+      // fill histograms
+      registry.fill(HIST("hVtx2ProngX"), secondaryVertex[0]);
+      registry.fill(HIST("hVtx2ProngY"), secondaryVertex[1]);
+      registry.fill(HIST("hVtx2ProngZ"), secondaryVertex[2]);
+      std::array<std::array<float, 3>, 2> arrMom = {pVec0, pVec1};
+      auto mass2Prong = RecoDecay::m(arrMom, arrMassPiK);
+      registry.fill(HIST("hMassD0ToPiK"), mass2Prong);
+    }
+
+    for (const auto& result : output.results3Prong) {
+      // fill table row
+      rowTrackIndexProng3(result.prong0Id,
+                          result.prong1Id,
+                          result.prong2Id);
+
+      // fill histograms
+      registry.fill(HIST("hVtx3ProngX"), result.secondaryVertex[0]);
+      registry.fill(HIST("hVtx3ProngY"), result.secondaryVertex[1]);
+      registry.fill(HIST("hVtx3ProngZ"), result.secondaryVertex[2]);
+      std::array<std::array<float, 3>, 3> arrMom = {result.pVec0, result.pVec1, result.pVec2};
+      auto mass3Prong = RecoDecay::m(arrMom, arrMassPiKPi);
+      registry.fill(HIST("hMassDPlusToPiKPi"), mass3Prong);
+    }
+
+    // fill fitter histograms
+    if (fillFitterQa) {
+      hf_fitter_qa::fill(registry, fitterSummary, output.fitterCalls);
+    }
+
+    // count the tested pairs
+    registry.fill(HIST("hNPairs2Prong"), 0.5, output.nPairs);
+  }
+
+  /// Processes the collisions one by one
+  void processSerial(aod::Collision const&,
+                     SelectedTracks const& tracks)
+  {
+    // split the tracks by charge
+    trackBuffers.fill(tracks, magneticField, do3Prong);
+
+    pairs.clear();
+    makePairs(trackBuffers, 0, pairs);
+    fillOutput(pairs);
+  }
+  PROCESS_SWITCH(HfTrackIndexSkimCreator, processSerial, "Process collisions sequentially", true);
+
+  /// Processes the collisions of a timeframe in parallel
+  /// The collisions are dispatched dynamically to nThreads workers, each with its own fitter.
+  /// The outputs are buffered per collision and written in collision order at the end of the timeframe,
+  /// so the tables and histograms are identical to the sequential processing.
+  void processParallel(aod::Collisions const& collisions,
+                       SelectedTracks const& tracks)
+  {
+    int nCollisions = collisions.size();
+    trackBuffersPerCollision.resize(nCollisions);
+    pairsPerCollision.resize(nCollisions);
+    for (int i = 0; i < nCollisions; ++i) {
+      trackBuffersPerCollision[i].clear();
+      pairsPerCollision[i].clear();
+    }
+
+    // split the tracks by collision and charge
+    for (auto const& track : tracks) {
+      if (!track.has_collision()) {
+        continue;
+      }
+      trackBuffersPerCollision[track.collisionId()].add(track, magneticField, do3Prong);
+    }
+
+    // pair the tracks in parallel, the next collision is taken by whichever worker becomes free first
+    std::atomic<int> nextCollision{0};
+    auto worker = [&](int iThread) {
+      for (int iCollision = nextCollision++; iCollision < nCollisions; iCollision = nextCollision++) {
+        makePairs(trackBuffersPerCollision[iCollision], iThread, pairsPerCollision[iCollision]);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (int iThread = 1; iThread < static_cast<int>(fitters2Prong.size()); ++iThread) {
+      threads.emplace_back(worker, iThread);
+    }
+    worker(0);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    // write the outputs in collision order
+    size_t nRows2Prong = 0;
+    size_t nRows3Prong = 0;
+    for (const auto& pairsCollision : pairsPerCollision) {
+      nRows2Prong += pairsCollision.results.size();
+      nRows3Prong += pairsCollision.results3Prong.size();
+    }
+    rowTrackIndexProng2.reserve(nRows2Prong);
+    if (fillFitResults) {
+      rowTrackIndexProng2Fit.reserve(nRows2Prong);
+    }
+    rowTrackIndexProng3.reserve(nRows3Prong);
+    for (int i = 0; i < nCollisions; ++i) {
+      fillOutput(pairsPerCollision[i]);
+    }
+  }
+  PROCESS_SWITCH(HfTrackIndexSkimCreator, processParallel, "Process the collisions of a timeframe in parallel", false);
+};
+
+// Candidate creation =====================================================================
+
+namespace o2::aod
+{
+// 2-prong decay properties
+namespace hf_cand_prong2
+{
+// Candidate columns
+// collision properties
+DECLARE_SOA_INDEX_COLUMN(Collision, collision); //! collisions
+// secondary vertex
+DECLARE_SOA_COLUMN(XSecondaryVertex, xSecondaryVertex, float); //! x coordinate of the secondary vertex
+DECLARE_SOA_COLUMN(YSecondaryVertex, ySecondaryVertex, float); //! y coordinate of the secondary vertex
+DECLARE_SOA_COLUMN(ZSecondaryVertex, zSecondaryVertex, float); //! z coordinate of the secondary vertex
+DECLARE_SOA_DYNAMIC_COLUMN(RSecondaryVertex, rSecondaryVertex, //! radius of the secondary vertex
+                           [](float xVtxS, float yVtxS) -> float { return RecoDecay::sqrtSumOfSquares(xVtxS, yVtxS); });
+// prong properties
+DECLARE_SOA_COLUMN(PxProng0, pxProng0, float); //! px of prong 0
+DECLARE_SOA_COLUMN(PyProng0, pyProng0, float); //! py of prong 0
+DECLARE_SOA_COLUMN(PzProng0, pzProng0, float); //! pz of prong 0
+DECLARE_SOA_DYNAMIC_COLUMN(PtProng0, ptProng0, //! pt of prong 0
+                           [](float px, float py) -> float { return RecoDecay::pt(px, py); });
+DECLARE_SOA_COLUMN(PxProng1, pxProng1, float); //! px of prong 1
+DECLARE_SOA_COLUMN(PyProng1, pyProng1, float); //! py of prong 1
+DECLARE_SOA_COLUMN(PzProng1, pzProng1, float); //! pz of prong 1
+DECLARE_SOA_DYNAMIC_COLUMN(PtProng1, ptProng1, //! pt of prong 1
+                           [](float px, float py) -> float { return RecoDecay::pt(px, py); });
+// candidate properties
+DECLARE_SOA_DYNAMIC_COLUMN(DecayLength, decayLength, //! decay length of candidate
+                           [](float xVtxP, float yVtxP, float zVtxP, float xVtxS, float yVtxS, float zVtxS) -> float { return RecoDecay::distance(array{xVtxP, yVtxP, zVtxP}, array{xVtxS, yVtxS, zVtxS}); });
+DECLARE_SOA_DYNAMIC_COLUMN(Pt, pt, //! pt of candidate
+                           [](float px, float py) -> float { return RecoDecay::pt(px, py); });
+DECLARE_SOA_EXPRESSION_COLUMN(Px, px, //! px of candidate
+                              float, 1.f * pxProng0 + 1.f * pxProng1);
+DECLARE_SOA_EXPRESSION_COLUMN(Py, py, //! py of candidate
+                              float, 1.f * pyProng0 + 1.f * pyProng1);
+DECLARE_SOA_EXPRESSION_COLUMN(Pz, pz, //! pz of candidate
+                              float, 1.f * pzProng0 + 1.f * pzProng1);
+DECLARE_SOA_DYNAMIC_COLUMN(M, m, //! invariant mass of candidate
+                           [](float px0, float py0, float pz0, float px1, float py1, float pz1, const array<double, 2>& m) -> float { return RecoDecay::m(array{array{px0, py0, pz0}, array{px1, py1, pz1}}, m); });
+DECLARE_SOA_DYNAMIC_COLUMN(CPA, cpa, //! cosine of pointing angle of candidate
+                           [](float xVtxP, float yVtxP, float zVtxP, float xVtxS, float yVtxS, float zVtxS, float px, float py, float pz) -> float { return RecoDecay::cpa(array{xVtxP, yVtxP, zVtxP}, array{xVtxS, yVtxS, zVtxS}, array{px, py, pz}); });
+DECLARE_SOA_DYNAMIC_COLUMN(Y, y, //! rapidity of candidate
+                           [](float px, float py, float pz, double m) -> float { return RecoDecay::y(array{px, py, pz}, m); });
+
+// stored copies of the dynamic columns for fixed mass hypotheses (see the HfCandProng2Mat table)
+/// Expression of the energy of a prong
+inline Node exprEnergy(BindingNode px, BindingNode py, BindingNode pz, float mass)
+{
+  return nsqrt(px * px + py * py + pz * pz + mass * mass);
+}
+
+/// Expression of the squared momentum of the candidate
+inline Node exprP2()
+{
+  return (pxProng0 + pxProng1) * (pxProng0 + pxProng1) + (pyProng0 + pyProng1) * (pyProng0 + pyProng1) + (pzProng0 + pzProng1) * (pzProng0 + pzProng1);
+}
+
+/// Expression of the invariant mass of the candidate
+inline Node exprMass(float mass0, float mass1)
+{
+  return nsqrt((exprEnergy(pxProng0, pyProng0, pzProng0, mass0) + exprEnergy(pxProng1, pyProng1, pzProng1, mass1)) *
+                 (exprEnergy(pxProng0, pyProng0, pzProng0, mass0) + exprEnergy(pxProng1, pyProng1, pzProng1, mass1)) -
+               exprP2());
+}
+
+/// Expression of the projection of the decay length on the candidate momentum
+inline Node exprDecayLengthDotP()
+{
+  return (xSecondaryVertex - collision::posX) * (pxProng0 + pxProng1) + (ySecondaryVertex - collision::posY) * (pyProng0 + pyProng1) + (zSecondaryVertex - collision::posZ) * (pzProng0 + pzProng1);
+}
+
+/// Expression of the squared decay length
+inline Node exprDecayLength2()
+{
+  return (xSecondaryVertex - collision::posX) * (xSecondaryVertex - collision::posX) + (ySecondaryVertex - collision::posY) * (ySecondaryVertex - collision::posY) + (zSecondaryVertex - collision::posZ) * (zSecondaryVertex - collision::posZ);
+}
+
+/// Expression of the rapidity of the candidate
+inline Node exprY(float mass)
+{
+  return 0.5f * nlog((nsqrt(exprP2() + mass * mass) + (pzProng0 + pzProng1)) / (nsqrt(exprP2() + mass * mass) - (pzProng0 + pzProng1)));
+}
+
+DECLARE_SOA_EXPRESSION_COLUMN(MPiK, mPiK, //! invariant mass of candidate with the π K hypothesis
+                              float, exprMass(static_cast<float>(massPi), static_cast<float>(massK)));
+DECLARE_SOA_EXPRESSION_COLUMN(MKPi, mKPi, //! invariant mass of candidate with the K π hypothesis
+                              float, exprMass(static_cast<float>(massK), static_cast<float>(massPi)));
+DECLARE_SOA_EXPRESSION_COLUMN(CpaStored, cpaStored, //! cosine of pointing angle of candidate
+                              float, exprDecayLengthDotP() / nsqrt(exprDecayLength2() * exprP2()));
+DECLARE_SOA_EXPRESSION_COLUMN(YStoredD0, yStoredD0, //! rapidity of candidate with the D0 mass hypothesis
+                              float, exprY(static_cast<float>(RecoDecay::getMassPDG(pdg::Code::kD0))));
+
+/// @brief Invariant mass of a D0 -> π K candidate
+/// @tparam T
+/// @param candidate
+/// @return invariant mass
+template <typename T>
+auto invMassD0(const T& candidate)
+{
+  return candidate.m(array{RecoDecay::getMassPDG(kPiPlus), RecoDecay::getMassPDG(kKPlus)});
+}
+
+/// @brief Invariant mass of a D0bar -> K π candidate
+/// @tparam T
+/// @param candidate
+/// @return invariant mass
+template <typename T>
+auto invMassD0bar(const T& candidate)
+{
+  return candidate.m(array{RecoDecay::getMassPDG(kKPlus), RecoDecay::getMassPDG(kPiPlus)});
+}
+
+/// @brief Rapidity of a D0 candidate
+/// @tparam T
+/// @param candidate
+/// @return rapidity
+template <typename T>
+auto yD0(const T& candidate)
+{
+  return candidate.y(RecoDecay::getMassPDG(pdg::Code::kD0));
+}
+} // namespace hf_cand_prong2
+
+// Candidate table
+DECLARE_SOA_TABLE(HfCandProng2Base, "AOD", "HFCANDP2BASE", //! 2-prong candidate table
+                  hf_cand_prong2::CollisionId,
+                  collision::PosX, collision::PosY, collision::PosZ,
+                  hf_cand_prong2::XSecondaryVertex, hf_cand_prong2::YSecondaryVertex, hf_cand_prong2::ZSecondaryVertex,
+                  /* dynamic columns */ hf_cand_prong2::RSecondaryVertex<hf_cand_prong2::XSecondaryVertex, hf_cand_prong2::YSecondaryVertex>,
+                  hf_cand_prong2::DecayLength<collision::PosX, collision::PosY, collision::PosZ, hf_cand_prong2::XSecondaryVertex, hf_cand_prong2::YSecondaryVertex, hf_cand_prong2::ZSecondaryVertex>,
+                  /* prong 0 */ hf_cand_prong2::PtProng0<hf_cand_prong2::PxProng0, hf_cand_prong2::PyProng0>,
+                  hf_cand_prong2::PxProng0, hf_cand_prong2::PyProng0, hf_cand_prong2::PzProng0,
+                  /* prong 1 */ hf_cand_prong2::PtProng1<hf_cand_prong2::PxProng1, hf_cand_prong2::PyProng1>,
+                  hf_cand_prong2::PxProng1, hf_cand_prong2::PyProng1, hf_cand_prong2::PzProng1,
+                  hf_track_index::Prong0Id, hf_track_index::Prong1Id,
+                  /* dynamic columns */
+                  hf_cand_prong2::M<hf_cand_prong2::PxProng0, hf_cand_prong2::PyProng0, hf_cand_prong2::PzProng0, hf_cand_prong2::PxProng1, hf_cand_prong2::PyProng1, hf_cand_prong2::PzProng1>,
+                  /* dynamic columns that use candidate momentum components */
+                  hf_cand_prong2::CPA<collision::PosX, collision::PosY, collision::PosZ, hf_cand_prong2::XSecondaryVertex, hf_cand_prong2::YSecondaryVertex, hf_cand_prong2::ZSecondaryVertex, hf_cand_prong2::Px, hf_cand_prong2::Py, hf_cand_prong2::Pz>,
+                  hf_cand_prong2::Pt<hf_cand_prong2::Px, hf_cand_prong2::Py>,
+                  hf_cand_prong2::Y<hf_cand_prong2::Px, hf_cand_prong2::Py, hf_cand_prong2::Pz>);
+
+// Extended table with expression columns that can be used as arguments of dynamic columns
+DECLARE_SOA_EXTENDED_TABLE_USER(HfCandProng2Ext, HfCandProng2Base, "HFCANDP2EXT", //! extension table for the 2-prong candidate table
+                                hf_cand_prong2::Px, hf_cand_prong2::Py, hf_cand_prong2::Pz);
+
+using HfCandProng2 = HfCandProng2Ext;
+
+// Extended table with stored invariant masses, CPA and rapidity (spawned with the materialize-columns workflow option)
+DECLARE_SOA_EXTENDED_TABLE_USER(HfCandProng2Mat, HfCandProng2Base, "HFCANDP2MAT", //! extension table with stored copies of the dynamic columns
+                                hf_cand_prong2::MPiK, hf_cand_prong2::MKPi, hf_cand_prong2::CpaStored, hf_cand_prong2::YStoredD0);
+
+} // namespace o2::aod
+
+/// Candidate creator
+/// Reconstruction of heavy-flavour 2-prong decay candidates
+struct HfCandidateCreator2Prong {
+  Produces<aod::HfCandProng2Base> rowCandidateBase;
+
+  Configurable<double> magneticField{"magneticField", 5., "magnetic field [kG]"};
+  Configurable<bool> propToDCA{"propToDCA", true, "create tracks version propagated to PCA"};
+  Configurable<bool> useAbsDCA{"useAbsDCA", true, "Minimise abs. distance rather than chi2"};
+  Configurable<double> maxR{"maxR", 200., "reject PCA's above this radius"};
+  Configurable<double> maxDZIni{"maxDZIni", 4., "reject (if>0) PCA candidate if tracks DZ exceeds threshold"};
+  Configurable<double> minParamChange{"minParamChange", 1.e-3, "stop iterations if largest change of any X is smaller than this"};
+  Configurable<double> minRelChi2Change{"minRelChi2Change", 0.9, "stop iterations if chi2/chi2old > this"};
+  Configurable<bool> fillFitterQa{"fillFitterQa", false, "record iterations, status, time and number of PCA candidates of each vertex fit"};
+
+  double massPiK{0.};
+  double massKPi{0.};
+
+  using TracksWithCov = soa::Join<Tracks, TracksCov>;
+  using TrackIndexProng2WithFit = soa::Join<aod::HfTrackIndexProng2, aod::HfTrackIndexProng2Fit>;
+
+  hf_track_buffer::TrackParCovCache trackParCovCache; // track parametrisations converted in the current timeframe
+  std::vector<std::pair<int, int64_t>> rowsByCollision; // (collision index, index row) pairs of the current timeframe ordered by collision
+
+  std::vector<hf_fitter_qa::FitterCall> fitterCalls; // records of the vertex fits of the current timeframe
+  hf_fitter_qa::FitterSummary fitterSummary;        // summary of the vertex fits, printed at the end of the stream
+
+  OutputObj<TH1F> hMass{TH1F("hMass", "2-prong candidates;inv. mass (#pi K) (GeV/#it{c}^{2});entries", 500, 0., 5.)};
+  HistogramRegistry registry{"registry", {}};
+
+  void init(o2::framework::InitContext& initContext)
+  {
+    if (doprocessRefit && doprocessFitResults) {
+      LOGF(fatal, "Cannot enable processRefit and processFitResults at the same time. Please choose one.");
+    }
+
+    if (fillFitterQa) {
+      hf_fitter_qa::addHistograms(registry);
+      initContext.services().get<CallbackService>().set<CallbackService::Id::EndOfStream>([this](EndOfStreamContext&) { fitterSummary.print("hf-candidate-creator2-prong"); });
+    }
+    if (doprocessCompareFitResults) {
+      registry.add("hResidualXPca", "2-prong candidates;#it{x}_{sec. vtx.}^{stored} #minus #it{x}_{sec. vtx.}^{refit} (cm);entries", {HistType::kTH1F, {{200, -1.e-4, 1.e-4}}});
+      registry.add("hResidualYPca", "2-prong candidates;#it{y}_{sec. vtx.}^{stored} #minus #it{y}_{sec. vtx.}^{refit} (cm);entries", {HistType::kTH1F, {{200, -1.e-4, 1.e-4}}});
+      registry.add("hResidualZPca", "2-prong candidates;#it{z}_{sec. vtx.}^{stored} #minus #it{z}_{sec. vtx.}^{refit} (cm);entries", {HistType::kTH1F, {{200, -1.e-4, 1.e-4}}});
+      registry.add("hResidualMassPiK", "2-prong candidates;inv. mass (#pi K)^{stored} #minus inv. mass (#pi K)^{refit} (GeV/#it{c}^{2});entries", {HistType::kTH1F, {{200, -1.e-4, 1.e-4}}});
+      registry.add("hCompareRefitFailed", "2-prong candidates;refit failed;entries", {HistType::kTH1F, {{2, -0.5, 1.5}}});
+    }
+  }
+
+  /// Applies the vertexing parameters to a fitter
+  /// \param df 2-prong vertex fitter
+  void configureFitter(o2::vertexing::DCAFitterN<2>& df)
+  {
+    df.setBz(magneticField);
+    df.setPropagateToPCA(propToDCA);
+    df.setMaxR(maxR);
+    df.setMaxDZIni(maxDZIni);
+    df.setMinParamChange(minParamChange);
+    df.setMinRelChi2Change(minRelChi2Change);
+    df.setUseAbsDCA(useAbsDCA);
+  }
+
+  /// Fills the candidate table row and the histograms
+  /// \param collision collision of the candidate
+  /// \param secondaryVertex position of the secondary vertex
+  /// \param pVec0 momentum of prong 0 at the secondary vertex
+  /// \param pVec1 momentum of prong 1 at the secondary vertex
+  /// \param prong0Id global index of prong 0
+  /// \param prong1Id global index of prong 1
+  template <typename TCollision, typename TVertex>
+  void fillCandidate(const TCollision& collision, const TVertex& secondaryVertex,
+                     const array<float, 3>& pVec0, const array<float, 3>& pVec1,
+                     int64_t prong0Id, int64_t prong1Id)
+  {
+    // fill candidate table rows
+    rowCandidateBase(collision.globalIndex(),
+                     collision.posX(), collision.posY(), collision.posZ(),
+                     secondaryVertex[0], secondaryVertex[1], secondaryVertex[2],
+                     pVec0[0], pVec0[1], pVec0[2],
+                     pVec1[0], pVec1[1], pVec1[2],
+                     prong0Id, prong1Id);
+
+    // fill histograms
+    // calculate invariant masses
+    auto arrayMomenta = std::array{pVec0, pVec1};
+    massPiK = RecoDecay::m(arrayMomenta, arrMassPiK);
+    massKPi = RecoDecay::m(arrayMomenta, arrMassKPi);
+    hMass->Fill(massPiK);
+    // hMass->Fill(massKPi);
+  }
+
+  /// Orders the index rows by the collision of their first prong
+  /// The candidates are then reconstructed collision by collision, so that each collision is accessed once,
+  /// the accessed tracks stay local and the candidate table is written in collision order.
+  /// \param rowsTrackIndexProng2 index rows
+  template <typename TTracks, typename TRows>
+  void sortRowsByCollision(const TRows& rowsTrackIndexProng2)
+  {
+    rowsByCollision.clear();
+    rowsByCollision.reserve(rowsTrackIndexProng2.size());
+    int64_t indexRow = 0;
+    for (auto const& rowTrackIndexProng2 : rowsTrackIndexProng2) {
+      rowsByCollision.emplace_back(rowTrackIndexProng2.template prong0_as<TTracks>().collisionId(), indexRow++);
+    }
+    // The skim creator writes the index rows collision by collision, so the sorting is normally skipped.
+    auto compareCollision = [](const auto& a, const auto& b) { return a.first < b.first; };
+    if (!std::is_sorted(rowsByCollision.begin(), rowsByCollision.end(), compareCollision)) {
+      std::stable_sort(rowsByCollision.begin(), rowsByCollision.end(), compareCollision);
+    }
+  }
+
+  /// Reconstructs the candidates by refitting the secondary vertices
+  void processRefit(aod::Collisions const& collisions,
+                    aod::HfTrackIndexProng2 const& rowsTrackIndexProng2,
+                    TracksWithCov const& tracks)
+  {
+    trackParCovCache.reset(tracks);
+    sortRowsByCollision<TracksWithCov>(rowsTrackIndexProng2);
+    fitterCalls.clear();
+    // upper limit, the pairs that fail the refit are not written
+    rowCandidateBase.reserve(rowsTrackIndexProng2.size());
+
+    // 2-prong vertex fitter
+    o2::vertexing::DCAFitterN<2> df;
+    configureFitter(df);
+
+    // loop over collisions
+    for (size_t iRow = 0; iRow < rowsByCollision.size();) {
+      auto collisionId = rowsByCollision[iRow].first;
+      auto collision = collisions.iteratorAt(collisionId);
+
+      // loop over pairs of track indices of the collision
+      for (; iRow < rowsByCollision.size() && rowsByCollision[iRow].first == collisionId; ++iRow) {
+        auto rowTrackIndexProng2 = rowsTrackIndexProng2.iteratorAt(rowsByCollision[iRow].second);
+        auto track0 = rowTrackIndexProng2.prong0_as<TracksWithCov>();
+        auto track1 = rowTrackIndexProng2.prong1_as<TracksWithCov>();
+        const auto& trackParVarPos1 = trackParCovCache.get(track0);
+        const auto& trackParVarNeg1 = trackParCovCache.get(track1);
+
+        // reconstruct the 2-prong secondary vertex
+        auto nCandidates = fillFitterQa ? hf_fitter_qa::processAndRecord(df, fitterCalls, trackParVarPos1, trackParVarNeg1) : df.process(trackParVarPos1, trackParVarNeg1);
+        if (nCandidates == 0) {
+          continue;
+        }
+        const auto& secondaryVertex = df.getPCACandidate();
+        auto trackParVar0 = df.getTrack(0);
+        auto trackParVar1 = df.getTrack(1);
+
+        // get track momenta
+        array<float, 3> pVec0;
+        array<float, 3> pVec1;
+        trackParVar0.getPxPyPzGlo(pVec0);
+        trackParVar1.getPxPyPzGlo(pVec1);
+
+        fillCandidate(collision, secondaryVertex, pVec0, pVec1, rowTrackIndexProng2.prong0Id(), rowTrackIndexProng2.prong1Id());
+      }
+    }
+
+    // fill fitter histograms
+    if (fillFitterQa) {
+      hf_fitter_qa::fill(registry, fitterSummary, fitterCalls);
+    }
+  }
+  PROCESS_SWITCH(HfCandidateCreator2Prong, processRefit, "Reconstruct candidates by refitting the secondary vertices", true);
+
+  /// Reconstructs the candidates from the vertex fit results stored by the skim creator
+  /// \note Requires fillFitResults enabled in the skim creator. Reads neither the track covariances nor the fitter.
+  void processFitResults(aod::Collisions const& collisions,
+                         TrackIndexProng2WithFit const& rowsTrackIndexProng2,
+                         aod::Tracks const&)
+  {
+    sortRowsByCollision<aod::Tracks>(rowsTrackIndexProng2);
+    rowCandidateBase.reserve(rowsTrackIndexProng2.size());
+
+    // loop over collisions
+    for (size_t iRow = 0; iRow < rowsByCollision.size();) {
+      auto collisionId = rowsByCollision[iRow].first;
+      auto collision = collisions.iteratorAt(collisionId);
+
+      // loop over pairs of track indices of the collision
+      for (; iRow < rowsByCollision.size() && rowsByCollision[iRow].first == collisionId; ++iRow) {
+        auto rowTrackIndexProng2 = rowsTrackIndexProng2.iteratorAt(rowsByCollision[iRow].second);
+        auto secondaryVertex = std::array{rowTrackIndexProng2.xPca(), rowTrackIndexProng2.yPca(), rowTrackIndexProng2.zPca()};
+        array<float, 3> pVec0{rowTrackIndexProng2.pxProng0(), rowTrackIndexProng2.pyProng0(), rowTrackIndexProng2.pzProng0()};
+        array<float, 3> pVec1{rowTrackIndexProng2.pxProng1(), rowTrackIndexProng2.pyProng1(), rowTrackIndexProng2.pzProng1()};
+
+        fillCandidate(collision, secondaryVertex, pVec0, pVec1, rowTrackIndexProng2.prong0Id(), rowTrackIndexProng2.prong1Id());
+      }
+    }
+  }
+  PROCESS_SWITCH(HfCandidateCreator2Prong, processFitResults, "Reconstruct candidates from the stored vertex fit results", false);
+
+  /// Compares the vertex fit results stored by the skim creator with a refit of the same pairs
+  /// The residuals show the precision lost by storing the results in single precision
+  /// and the effect of different vertexing parameters in the skim creator and in this task.
+  /// \note Requires fillFitResults enabled in the skim creator. Does not produce candidates.
+  void processCompareFitResults(TrackIndexProng2WithFit const& rowsTrackIndexProng2,
+                                TracksWithCov const& tracks)
+  {
+    trackParCovCache.reset(tracks);
+
+    // 2-prong vertex fitter
+    o2::vertexing::DCAFitterN<2> df;
+    configureFitter(df);
+
+    for (auto const& rowTrackIndexProng2 : rowsTrackIndexProng2) {
+      const auto& trackParVar0 = trackParCovCache.get(rowTrackIndexProng2.prong0_as<TracksWithCov>());
+      const auto& trackParVar1 = trackParCovCache.get(rowTrackIndexProng2.prong1_as<TracksWithCov>());
+      if (df.process(trackParVar0, trackParVar1) == 0) {
+        registry.fill(HIST("hCompareRefitFailed"), 1);
+        continue;
+      }
+      registry.fill(HIST("hCompareRefitFailed"), 0);
+      const auto& secondaryVertex = df.getPCACandidate();
+      array<float, 3> pVec0;
+      array<float, 3> pVec1;
+      df.getTrack(0).getPxPyPzGlo(pVec0);
+      df.getTrack(1).getPxPyPzGlo(pVec1);
+      array<float, 3> pVec0Stored{rowTrackIndexProng2.pxProng0(), rowTrackIndexProng2.pyProng0(), rowTrackIndexProng2.pzProng0()};
+      array<float, 3> pVec1Stored{rowTrackIndexProng2.pxProng1(), rowTrackIndexProng2.pyProng1(), rowTrackIndexProng2.pzProng1()};
+      auto massPiKStored = RecoDecay::m(std::array{pVec0Stored, pVec1Stored}, arrMassPiK);
+      auto massPiKRefit = RecoDecay::m(std::array{pVec0, pVec1}, arrMassPiK);
+      registry.fill(HIST("hResidualXPca"), rowTrackIndexProng2.xPca() - secondaryVertex[0]);
+      registry.fill(HIST("hResidualYPca"), rowTrackIndexProng2.yPca() - secondaryVertex[1]);
+      registry.fill(HIST("hResidualZPca"), rowTrackIndexProng2.zPca() - secondaryVertex[2]);
+      registry.fill(HIST("hResidualMassPiK"), massPiKStored - massPiKRefit);
+    }
+  }
+  PROCESS_SWITCH(HfCandidateCreator2Prong, processCompareFitResults, "Compare the stored vertex fit results with a refit", false);
+};
+
+/// Helper extension task
+/// Extends the base table with expression columns (see the HfCandProng2Ext table).
+struct HfCandidateCreator2ProngExpressions {
+  Spawns<aod::HfCandProng2Ext> rowCandidateProng2;
+  void init(InitContext const&) {}
+};
+
+/// Helper extension task
+/// Extends the base table with stored invariant masses, CPA and rapidity (see the HfCandProng2Mat table),
+/// so that the consumers read contiguous floats instead of evaluating the dynamic columns per access.
+struct HfCandidateCreator2ProngMaterialized {
+  Spawns<aod::HfCandProng2Mat> rowCandidateProng2Mat;
+  void init(InitContext const&) {}
+};
+
+// Candidate selection =====================================================================
+
+namespace o2::aod
+{
+namespace hf_selcandidate_d0
+{
+// Candidate selection columns
+DECLARE_SOA_COLUMN(IsSelD0, isSelD0, int);       //! selection flag for D0
+DECLARE_SOA_COLUMN(IsSelD0bar, isSelD0bar, int); //! selection flag for D0 bar
+} // namespace hf_selcandidate_d0
+
+// Candidate selection table
+DECLARE_SOA_TABLE(HfSelCandidateD0, "AOD", "HFSELCANDD0", //! table with D0 selection flags
+                  hf_selcandidate_d0::IsSelD0,
+                  hf_selcandidate_d0::IsSelD0bar);
+
+namespace hf_cuts_d0
+{
+static constexpr int nBinsPt = 3;
+static constexpr int nCutVars = 2;
+// default values for the pT bin edges (can be used to configure histogram axis)
+// offset by 1 from the bin numbers in cuts array
+constexpr double binsPt[nBinsPt + 1] = {
+  0.,
+  5.0,
+  10.0,
+  50.0};
+auto vecBinsPt = std::vector<double>{binsPt, binsPt + nBinsPt + 1};
+
+// default values for the cuts
+constexpr double cuts[nBinsPt][nCutVars] = {{0.4, 0.98},  /* 0  < pT < 5  */
+                                            {0.4, 0.98},  /* 5  < pT < 10 */
+                                            {0.4, 0.98}}; /* 10 < pT < 50 */
+
+// column labels
+static const std::vector<std::string> labelsCutVar = {"m", "cos pointing angle"};
+
+// row labels
+static const std::vector<std::string> labelsPt = {
+  "pT bin 0",
+  "pT bin 1",
+  "pT bin 2"};
+} // namespace hf_cuts_d0
+} // namespace o2::aod
+
+/// D0 candidate selector
+struct HfCandidateSelectorD0 {
+  Produces<aod::HfSelCandidateD0> hfSelD0Candidate;
+
+  Configurable<double> ptCandMin{"ptCandMin", 0., "Lower bound of candidate pT"};
+  Configurable<double> ptCandMax{"ptCandMax", 50., "Upper bound of candidate pT"};
+  // topological cuts
+  Configurable<std::vector<double>> binsPt{"binsPt", std::vector<double>{hf_cuts_d0::vecBinsPt}, "pT bin limits"};
+  Configurable<LabeledArray<double>> cuts{"cuts", {hf_cuts_d0::cuts[0], hf_cuts_d0::nBinsPt, hf_cuts_d0::nCutVars, hf_cuts_d0::labelsPt, hf_cuts_d0::labelsCutVar}, "D0 candidate selection per pT bin"};
+
+  using TracksWithPid = soa::Join<Tracks, aod::HfPidTrack>;
+
+  // cut configuration compiled in init, indexed by pT bin
+  std::vector<double> binsPtCut; // pT bin limits
+  std::vector<double> cutsMass;  // half-widths of the invariant-mass window
+  std::vector<double> cutsCpa;   // min. cosines of pointing angle
+  bool isUniformBinsPt{false};   // whether all pT bins have the same width
+  double invWidthBinsPt{0.};     // inverse width of uniform pT bins
+
+  void init(o2::framework::InitContext&)
+  {
+    if (doprocessDynamic && doprocessStored) {
+      LOGF(fatal, "Cannot enable processDynamic and processStored at the same time. Please choose one.");
+    }
+
+    // resolve the labels once, so that the selection only indexes flat arrays
+    binsPtCut = binsPt.value;
+    if (binsPtCut.size() < 2) {
+      LOGF(fatal, "binsPt must contain at least two bin limits, got %d", binsPtCut.size());
+    }
+    auto nBinsPt = binsPtCut.size() - 1;
+    if (cuts->rows() < nBinsPt) {
+      LOGF(fatal, "cuts has %d pT bins, binsPt defines %d", cuts->rows(), nBinsPt);
+    }
+    cutsMass.resize(nBinsPt);
+    cutsCpa.resize(nBinsPt);
+    for (size_t iBin = 0; iBin < nBinsPt; ++iBin) {
+      cutsMass[iBin] = cuts->get(iBin, "m");
+      cutsCpa[iBin] = cuts->get(iBin, "cos pointing angle");
+    }
+    auto widthBinsPt = (binsPtCut.back() - binsPtCut.front()) / nBinsPt;
+    isUniformBinsPt = true;
+    for (size_t iBin = 0; iBin < nBinsPt; ++iBin) {
+      if (std::abs(binsPtCut[iBin + 1] - binsPtCut[iBin] - widthBinsPt) > 1.e-9 * widthBinsPt) {
+        isUniformBinsPt = false;
+        break;
+      }
+    }
+    invWidthBinsPt = 1. / widthBinsPt;
+  }
+
+  /// Finds the pT bin of the cut configuration
+  /// Direct computation for uniform bins, binary search otherwise.
+  /// \param pt transverse momentum
+  /// \return bin index or -1 if outside the bin limits
+  int findBinPt(double pt) const
+  {
+    if (pt < binsPtCut.front() || pt >= binsPtCut.back()) {
+      return -1;
+    }
+    if (isUniformBinsPt) {
+      int nBinsPt = binsPtCut.size() - 1;
+      auto binPt = std::clamp(static_cast<int>((pt - binsPtCut.front()) * invWidthBinsPt), 0, nBinsPt - 1);
+      // the rounding of the computed index can be off by one at the bin limits, check it against the limits as in the binary search
+      if (pt < binsPtCut[binPt]) {
+        --binPt;
+      } else if (pt >= binsPtCut[binPt + 1]) {
+        ++binPt;
+      }
+      return binPt;
+    }
+    return std::upper_bound(binsPtCut.begin(), binsPtCut.end(), pt) - binsPtCut.begin() - 1;
+  }
+
+  /// Conjugate-independent topological cuts
+  /// \tparam useStoredColumns whether to read the stored columns of the HfCandProng2Mat table instead of the dynamic columns
+  /// \param candidate is candidate
+  /// \param binPt pT bin of the candidate
+  /// \return true if candidate passes all cuts
+  template <bool useStoredColumns, typename T>
+  bool selectionTopol(const T& candidate, int binPt)
+  {
+    if (binPt == -1) {
+      return false;
+    }
+    // check that the candidate pT is within the analysis range
+    if (candidate.pt() < ptCandMin || candidate.pt() >= ptCandMax) {
+      return false;
+    }
+    // cosine of pointing angle
+    if constexpr (useStoredColumns) {
+      if (candidate.cpaStored() < cutsCpa[binPt]) {
+        return false;
+      }
+    } else {
+      if (candidate.cpa() < cutsCpa[binPt]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Conjugate-dependent topological cuts
+  /// \tparam useStoredColumns whether to read the stored columns of the HfCandProng2Mat table instead of the dynamic columns
+  /// \param candidate candidate
+  /// \param binPt pT bin of the candidate
+  /// \param trackPion the track with the pion hypothesis
+  /// \param trackKaon the track with the kaon hypothesis
+  /// \note trackPion = positive and trackKaon = negative for D0 selection and inverse for D0bar
+  /// \return true if candidate passes all cuts for the given conjugate
+  template <bool useStoredColumns, typename T1, typename T2>
+  bool selectionTopolConjugate(const T1& candidate, int binPt, const T2& trackPion, const T2& trackKaon)
+  {
+    if (binPt == -1) {
+      return false;
+    }
+    // invariant-mass cut
+    double invMass;
+    if constexpr (useStoredColumns) {
+      invMass = trackPion.sign() > 0 ? candidate.mPiK() : candidate.mKPi();
+    } else {
+      invMass = trackPion.sign() > 0 ? invMassD0(candidate) : invMassD0bar(candidate);
+    }
+    if (std::abs(invMass - RecoDecay::getMassPDG(pdg::Code::kD0)) > cutsMass[binPt]) {
+      return false;
+    }
+    return true;
+  }
+
+  /// Selects the candidates and fills the selection table
+  /// \tparam useStoredColumns whether to read the stored columns of the HfCandProng2Mat table instead of the dynamic columns
+  /// \param candidates 2-prong candidates
+  template <bool useStoredColumns, typename T>
+  void selectCandidates(const T& candidates)
+  {
+    hfSelD0Candidate.reserve(candidates.size());
+    // looping over 2-prong candidates
+    for (auto const& candidate : candidates) {
+
+      // final selection flag: 0 - rejected, 1 - accepted
+      int statusD0 = 0;
+      int statusD0bar = 0;
+
+      auto trackPos = candidate.prong0_as<TracksWithPid>(); // positive daughter
+      auto trackNeg = candidate.prong1_as<TracksWithPid>(); // negative daughter
+
+      auto binPt = findBinPt(candidate.pt());
+
+      // conjugate-independent topological selection
+      if (!selectionTopol<useStoredColumns>(candidate, binPt)) {
+        hfSelD0Candidate(statusD0, statusD0bar);
+        continue;
+      }
+
+      // conjugate-dependent topological selection for D0
+      bool topolD0 = selectionTopolConjugate<useStoredColumns>(candidate, binPt, trackPos, trackNeg);
+      // conjugate-dependent topological selection for D0bar
+      bool topolD0bar = selectionTopolConjugate<useStoredColumns>(candidate, binPt, trackNeg, trackPos);
+
+      if (!topolD0 && !topolD0bar) {
+        hfSelD0Candidate(statusD0, statusD0bar);
+        continue;
+      }
+
+      // track-level PID selection
+      int pidTrackPosKaon = hf_pidtrack::getPidStatus(trackPos, hf_pidtrack::Kaon);
+      int pidTrackPosPion = hf_pidtrack::getPidStatus(trackPos, hf_pidtrack::Pion);
+      int pidTrackNegKaon = hf_pidtrack::getPidStatus(trackNeg, hf_pidtrack::Kaon);
+      int pidTrackNegPion = hf_pidtrack::getPidStatus(trackNeg, hf_pidtrack::Pion);
+
+      int pidD0 = -1;
+      int pidD0bar = -1;
+
+      if (pidTrackPosPion == TrackSelectorPID::Status::PIDAccepted &&
+          pidTrackNegKaon == TrackSelectorPID::Status::PIDAccepted) {
+        pidD0 = 1; // accept D0
+      } else if (pidTrackPosPion == TrackSelectorPID::Status::PIDRejected ||
+                 pidTrackNegKaon == TrackSelectorPID::Status::PIDRejected ||
+                 pidTrackNegPion == TrackSelectorPID::Status::PIDAccepted ||
+                 pidTrackPosKaon == TrackSelectorPID::Status::PIDAccepted) {
+        pidD0 = 0; // exclude D0
+      }
+
+      if (pidTrackNegPion == TrackSelectorPID::Status::PIDAccepted &&
+          pidTrackPosKaon == TrackSelectorPID::Status::PIDAccepted) {
+        pidD0bar = 1; // accept D0bar
+      } else if (pidTrackPosPion == TrackSelectorPID::Status::PIDAccepted ||
+                 pidTrackNegKaon == TrackSelectorPID::Status::PIDAccepted ||
+                 pidTrackNegPion == TrackSelectorPID::Status::PIDRejected ||
+                 pidTrackPosKaon == TrackSelectorPID::Status::PIDRejected) {
+        pidD0bar = 0; // exclude D0bar
+      }
+
+      if (pidD0 == 0 && pidD0bar == 0) {
+        hfSelD0Candidate(statusD0, statusD0bar);
+        continue;
+      }
+
+      if ((pidD0 == -1 || pidD0 == 1) && topolD0) {
+        statusD0 = 1; // identified as D0
+      }
+      if ((pidD0bar == -1 || pidD0bar == 1) && topolD0bar) {
+        statusD0bar = 1; // identified as D0bar
+      }
+
+      hfSelD0Candidate(statusD0, statusD0bar);
+    }
+  }
+
+  void processDynamic(aod::HfCandProng2 const& candidates,
+                      TracksWithPid const&)
+  {
+    selectCandidates<false>(candidates);
+  }
+  PROCESS_SWITCH(HfCandidateSelectorD0, processDynamic, "Use dynamic columns of candidates", true);
+
+  /// \note Requires the materialize-columns workflow option.
+  void processStored(soa::Join<aod::HfCandProng2, aod::HfCandProng2MatExtension> const& candidates,
+                     TracksWithPid const&)
+  {
+    selectCandidates<true>(candidates);
+  }
+  PROCESS_SWITCH(HfCandidateSelectorD0, processStored, "Use stored columns of candidates", false);
+};
+
+// Analysis task =====================================================================
+
+/// D0 analysis task
+struct HfTaskD0 {
+  Configurable<int> selectionFlagD0{"selectionFlagD0", 1, "Selection flag for D0"};
+  Configurable<int> selectionFlagD0bar{"selectionFlagD0bar", 1, "Selection flag for D0 bar"};
+
+  Filter filterSelectCandidates = aod::hf_selcandidate_d0::isSelD0 >= selectionFlagD0 || aod::hf_selcandidate_d0::isSelD0bar >= selectionFlagD0bar;
+
+  using CollisionsWithCounts = soa::Join<aod::Collisions, aod::HfCollTrackCounts>;
+
+  HistogramRegistry registry{
+    "registry",
+    {}};
+
+  void init(o2::framework::InitContext&)
+  {
+    if (doprocessDynamic && doprocessStored) {
+      LOGF(fatal, "Cannot enable processDynamic and processStored at the same time. Please choose one.");
+    }
+
+    const TString strTitle = "D^{0} candidates";
+    const TString strPt = "#it{p}_{T} (GeV/#it{c})";
+    const TString strEntries = "entries";
+    registry.add("hNTracks", "Tracks;# of tracks;entries", {HistType::kTH1F, {{200, 0., 200.}}});
+    registry.add("hNCandidates", strTitle + ";# of candidates;entries", {HistType::kTH1F, {{100, 0., 100.}}});
+    registry.add("hPtCand", strTitle + ";" + strPt + ";" + strEntries, {HistType::kTH1F, {{100, 0., 10.}}});
+    registry.add("hYCand", strTitle + ";" + "#it{y}^{D^{0}}" + ";" + strEntries, {HistType::kTH1F, {{200, -2., 2.}}});
+    registry.add("hMass", strTitle + ";" + "inv. mass (#pi K) (GeV/#it{c}^{2})" + ";" + strEntries, {HistType::kTH1F, {{500, 0., 5.}}});
+    registry.add("hCpaVsPtCand", strTitle + ";" + "cosine of pointing angle" + ";" + strPt + ";" + strEntries, {HistType::kTH2F, {{110, -1.1, 1.1}, {100, 0., 10.}}});
+  }
+
+  /// Fills the candidate histograms
+  /// \tparam useStoredColumns whether to read the stored columns of the HfCandProng2Mat table instead of the dynamic columns
+  /// \param candidates selected candidates of one collision
+  template <bool useStoredColumns, typename T>
+  void fillCandidates(const T& candidates)
+  {
+    for (auto const& candidate : candidates) {
+      if constexpr (useStoredColumns) {
+        if (candidate.isSelD0() >= selectionFlagD0) {
+          registry.fill(HIST("hMass"), candidate.mPiK());
+        }
+        if (candidate.isSelD0bar() >= selectionFlagD0bar) {
+          registry.fill(HIST("hMass"), candidate.mKPi());
+        }
+        registry.fill(HIST("hYCand"), candidate.yStoredD0());
+        registry.fill(HIST("hPtCand"), candidate.pt());
+        registry.fill(HIST("hCpaVsPtCand"), candidate.cpaStored(), candidate.pt());
+      } else {
+        if (candidate.isSelD0() >= selectionFlagD0) {
+          registry.fill(HIST("hMass"), invMassD0(candidate));
+        }
+        if (candidate.isSelD0bar() >= selectionFlagD0bar) {
+          registry.fill(HIST("hMass"), invMassD0bar(candidate));
+        }
+        registry.fill(HIST("hYCand"), yD0(candidate));
+        registry.fill(HIST("hPtCand"), candidate.pt());
+        registry.fill(HIST("hCpaVsPtCand"), candidate.cpa(), candidate.pt());
+      }
+    }
+  }
+
+  void processDynamic(CollisionsWithCounts::iterator const& collision, soa::Filtered<soa::Join<aod::HfCandProng2, aod::HfSelCandidateD0>> const& candidates)
+  {
+    registry.fill(HIST("hNTracks"), collision.nTracks());
+    registry.fill(HIST("hNCandidates"), candidates.size());
+    fillCandidates<false>(candidates);
+  }
+  PROCESS_SWITCH(HfTaskD0, processDynamic, "Use dynamic columns of candidates", true);
+
+  /// \note Requires the materialize-columns workflow option.
+  void processStored(CollisionsWithCounts::iterator const& collision, soa::Filtered<soa::Join<aod::HfCandProng2, aod::HfCandProng2MatExtension, aod::HfSelCandidateD0>> const& candidates)
+  {
+    registry.fill(HIST("hNTracks"), collision.nTracks());
+    registry.fill(HIST("hNCandidates"), candidates.size());
+    fillCandidates<true>(candidates);
+  }
+  PROCESS_SWITCH(HfTaskD0, processStored, "Use stored columns of candidates", false);
+};
+
+// Add all tasks in the workflow specification.
+WorkflowSpec defineDataProcessing(ConfigContext const& cfgc)
+{
+  WorkflowSpec workflow{
+    adaptAnalysisTask<HfTagSelTracks>(cfgc),
+    adaptAnalysisTask<HfTagPidTracks>(cfgc),
+    adaptAnalysisTask<HfTrackIndexSkimCreator>(cfgc),
+    adaptAnalysisTask<HfCandidateCreator2Prong>(cfgc),
+    adaptAnalysisTask<HfCandidateCreator2ProngExpressions>(cfgc),
+    adaptAnalysisTask<HfCandidateSelectorD0>(cfgc),
+    adaptAnalysisTask<HfTaskD0>(cfgc)};
+  if (cfgc.options().get<bool>("materialize-columns")) {
+    workflow.push_back(adaptAnalysisTask<HfCandidateCreator2ProngMaterialized>(cfgc));
+  }
+  return workflow;
+}